@@ -11,3 +11,6 @@ namespace apc
 #include "misc.hpp"
 #include "res.hpp"
 #include "parsers/parsers.hpp"
+#include "input/mapped_file.hpp"
+#include "input/buffered.hpp"
+#include "input/line_index.hpp"
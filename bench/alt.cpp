@@ -0,0 +1,107 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// Hides the first set of a parser so Alt has to try it on every input
+template< typename P >
+struct Opaque
+{
+    P parser;
+
+    using Ok = typename P::Ok;
+    using Err = typename P::Err;
+
+    template< typename I >
+    auto parse(I b, I e)
+    {
+        return parser.parse(b, e);
+    }
+};
+
+template< typename... Ps >
+auto opaque_alt(Ps... parsers)
+{
+    return alt(Opaque<Ps>{ move(parsers) }...);
+}
+
+const vector<string_view> keyword_list = {
+    "alignas", "break", "case", "catch", "class", "const", "continue", "default",
+    "delete", "do", "else", "enum", "explicit", "export", "extern", "for",
+    "friend", "goto", "if", "inline", "mutable", "namespace", "new", "operator",
+    "private", "public", "return", "static", "switch", "while",
+};
+
+template< template< typename... > class F >
+auto statement_keywords()
+{
+    return F<void>::make(
+        lit("alignas"), lit("break"), lit("case"), lit("catch"), lit("class"), lit("const"),
+        lit("continue"), lit("default"), lit("delete"), lit("do"), lit("else"), lit("enum"),
+        lit("explicit"), lit("export"), lit("extern"), lit("for"), lit("friend"), lit("goto"),
+        lit("if"), lit("inline"), lit("mutable"), lit("namespace"), lit("new"), lit("operator"),
+        lit("private"), lit("public"), lit("return"), lit("static"), lit("switch"), lit("while")
+    );
+}
+
+template< typename >
+struct MakeAlt
+{
+    template< typename... Ps >
+    static auto make(Ps... parsers)
+    {
+        return alt(move(parsers)...);
+    }
+};
+
+template< typename >
+struct MakeOpaqueAlt
+{
+    template< typename... Ps >
+    static auto make(Ps... parsers)
+    {
+        return opaque_alt(move(parsers)...);
+    }
+};
+
+template< typename P >
+void bench_alt(const string& name, P parser, const string& in, size_t n)
+{
+    auto p = many(move(parser)).with_delim(unit(' '));
+
+    bench::run(name, in.size(), n, [&]
+    {
+        auto res = p.parse(in.data(), in.data() + in.size());
+        bench::do_not_optimize(res.unwrap_ok().pos);
+    });
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    const size_t size = 1 << 20;
+
+    mt19937 rng(0);
+    string in;
+    size_t n = 0;
+    while (in.size() < size)
+    {
+        in += keyword_list[rng() % keyword_list.size()];
+        in += ' ';
+        n++;
+    }
+    in.pop_back();
+
+    bench_alt("alt 30 keywords, first set dispatch", statement_keywords<MakeAlt>(), in, n);
+    bench_alt("alt 30 keywords, sequential", statement_keywords<MakeOpaqueAlt>(), in, n);
+    bench_alt("keywords 30, first match", keywords(keyword_list), in, n);
+    bench_alt("keywords 30, longest match", keywords(keyword_list).longest(), in, n);
+    bench_alt("keywords 30, index", keywords(keyword_list).indexed(), in, n);
+}
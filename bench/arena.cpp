@@ -0,0 +1,89 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+auto letter()
+{
+    return alt(unit('a'), unit('b'), unit('c'), unit('d'), unit('e'), unit('f'));
+}
+
+// Runs f on every message, split between the given number of threads.
+// Every thread gets its own copy of f and of the parser in it
+template< typename F >
+void run_threads(size_t n_threads, const vector<string>& messages, F f)
+{
+    vector<thread> threads;
+    for (size_t t = 0; t < n_threads; t++)
+    {
+        threads.emplace_back([&, t, f]() mutable
+        {
+            for (size_t n = t; n < messages.size(); n += n_threads)
+            {
+                f(messages[n]);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// Small messages parsed into lists of strings, with the results on the
+// global heap and in a per thread arena that is released after every message.
+// The grammar is built once per run, so only the results allocate
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    vector<string> messages;
+    size_t bytes = 0;
+    for (size_t n = 0; n < 20000; n++)
+    {
+        string msg;
+        for (size_t field = 0; field < 4 + n % 8; field++)
+        {
+            msg += string(1 + (n + field) % 12, "abcdef"[field % 6]) + ",";
+        }
+        msg += "a;";
+
+        bytes += msg.size();
+        messages.push_back(move(msg));
+    }
+
+    size_t max_threads = max(1u, thread::hardware_concurrency());
+
+    for (size_t n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+    {
+        string suffix = ", " + to_string(n_threads) + (n_threads == 1 ? " thread" : " threads");
+
+        bench::run("global heap" + suffix, bytes, messages.size(), [&]
+        {
+            auto parser = sequence(many(many_str(letter())).with_delim(unit(',')), unit(';'));
+            run_threads(n_threads, messages, [parser](const string& msg) mutable
+            {
+                bench::do_not_optimize(parser.parse(msg.begin(), msg.end()).is_ok());
+            });
+        });
+
+        bench::run("arena" + suffix, bytes, messages.size(), [&]
+        {
+            auto parser = sequence(many_pmr(many_str_pmr(letter())).with_delim(unit(',')), unit(';'));
+            run_threads(n_threads, messages, [parser](const string& msg) mutable
+            {
+                thread_local Arena arena;
+
+                bench::do_not_optimize(parse_in(arena, parser, msg.begin(), msg.end()).is_ok());
+                arena.release();
+            });
+        });
+    }
+}
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "../instrument.hpp"
+#include "../profile.hpp"
+
+// Every benchmark is a single translation unit that includes this header once,
+// which makes it the place to replace the global allocation functions
+// so allocations can be counted.
+// Built with BENCH_FLAGS=-DAPC_INSTRUMENT a benchmark prints what every
+// parser did to stderr when it exits, with BENCH_FLAGS=-DAPC_PROFILE it prints
+// the time spent in named rules and writes their stacks to <benchmark>.folded
+
+namespace bench
+{
+    using namespace std;
+
+    inline atomic<size_t> allocations{ 0 };
+}
+
+namespace bench
+{
+    // Called by every replaced allocation function, so each of them is a
+    // plain malloc paired with a plain free and the compiler sees matching pairs
+    inline void* allocate(size_t size)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        apc::instrument::count_allocation();
+
+        if (void* p = std::malloc(size == 0 ? 1 : size))
+        {
+            return p;
+        }
+
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new(size_t size)
+{
+    return bench::allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return bench::allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace bench
+{
+    struct Options
+    {
+        // print one JSON object per line instead of a table
+        bool json = false;
+
+        // only run benchmarks whose name contains this
+        string filter;
+
+        double min_seconds = 0.2;
+
+        // size of generated inputs in MB, 0 keeps the benchmark's default
+        size_t size_mb = 0;
+    };
+
+    inline Options options;
+
+    // name of the benchmark program, reported with every result
+    inline string suite = "bench";
+
+    inline void usage(const char* program)
+    {
+        fprintf(stderr,
+                "usage: %s [--json] [--filter=TEXT] [--min-time=SECONDS] [--size=MB]\n",
+                program);
+    }
+
+    inline void init(int argc, char** argv)
+    {
+        if (argc > 0)
+        {
+            const char* slash = strrchr(argv[0], '/');
+            suite = slash != nullptr ? slash + 1 : argv[0];
+        }
+
+        for (int n = 1; n < argc; n++)
+        {
+            string arg = argv[n];
+
+            auto value = [&](const char* option) -> const char*
+            {
+                size_t len = strlen(option);
+                return arg.compare(0, len, option) == 0 ? argv[n] + len : nullptr;
+            };
+
+            if (arg == "--json")
+            {
+                options.json = true;
+            }
+            else if (const char* v = value("--filter="))
+            {
+                options.filter = v;
+            }
+            else if (const char* v = value("--min-time="))
+            {
+                options.min_seconds = atof(v);
+            }
+            else if (const char* v = value("--size="))
+            {
+                options.size_mb = strtoul(v, nullptr, 10);
+            }
+            else
+            {
+                usage(argv[0]);
+                exit(2);
+            }
+        }
+
+        if constexpr (apc::instrument::enabled)
+        {
+            // constructed before the handler is registered so it is still there when it runs
+            apc::instrument::global();
+            atexit([] { apc::instrument::report(cerr); });
+        }
+
+        if constexpr (apc::profile::enabled)
+        {
+            apc::profile::global();
+            apc::profile::ticks_per_second();
+            atexit([]
+            {
+                apc::profile::report(cerr);
+
+                ofstream out(suite + ".folded");
+                apc::profile::folded(out);
+            });
+        }
+    }
+
+    // Size of generated inputs in bytes
+    inline size_t input_size(size_t default_mb)
+    {
+        return (options.size_mb != 0 ? options.size_mb : default_mb) << 20;
+    }
+
+    // Keeps the optimizer from discarding a computed value
+    template< typename T >
+    void do_not_optimize(T&& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct Measurement
+    {
+        size_t iterations;
+        double seconds;
+        size_t allocations;
+    };
+
+    // Runs f repeatedly until at least min_seconds have passed
+    template< typename F >
+    Measurement measure(F&& f, double min_seconds = options.min_seconds)
+    {
+        using clock = chrono::steady_clock;
+
+        size_t iterations = 1;
+        while (true)
+        {
+            size_t allocs = allocations.load(memory_order_relaxed);
+            auto start = clock::now();
+            for (size_t i = 0; i < iterations; i++)
+            {
+                f();
+            }
+            double seconds = chrono::duration<double>(clock::now() - start).count();
+
+            if (seconds >= min_seconds)
+            {
+                return { iterations, seconds, allocations.load(memory_order_relaxed) - allocs };
+            }
+
+            iterations *= 2;
+        }
+    }
+
+    inline string json_escape(const string& s)
+    {
+        string ret;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+            {
+                ret += '\\';
+                ret += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                ret += buf;
+            }
+            else
+            {
+                ret += c;
+            }
+        }
+        return ret;
+    }
+
+    // bytes and elements are per invocation of f
+    template< typename F >
+    void run(const string& name, size_t bytes, size_t elements, F&& f)
+    {
+        if (name.find(options.filter) == string::npos)
+        {
+            return;
+        }
+
+        auto m = measure(forward<F>(f));
+        double per_iter = m.seconds / m.iterations;
+        double mb_per_s = bytes / per_iter / 1e6;
+        double ns_per_element = per_iter * 1e9 / elements;
+        double allocs_per_iter = double(m.allocations) / m.iterations;
+        double allocs_per_element = allocs_per_iter / elements;
+
+        if (options.json)
+        {
+            printf("{\"suite\": \"%s\", \"name\": \"%s\", \"mb_per_s\": %.3f, \"ns_per_element\": %.3f, "
+                   "\"allocs_per_iter\": %.3f, \"allocs_per_element\": %.3f, "
+                   "\"iterations\": %zu, \"bytes\": %zu, \"elements\": %zu}\n",
+                   json_escape(suite).c_str(),
+                   json_escape(name).c_str(),
+                   mb_per_s,
+                   ns_per_element,
+                   allocs_per_iter,
+                   allocs_per_element,
+                   m.iterations,
+                   bytes,
+                   elements);
+        }
+        else
+        {
+            printf("%-40s %10.1f MB/s %10.2f ns/element %10.1f allocs/iter %8.2f allocs/element\n",
+                   name.c_str(),
+                   mb_per_s,
+                   ns_per_element,
+                   allocs_per_iter,
+                   allocs_per_element);
+        }
+
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,156 @@
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// Log lines without raw or span_of, which need contiguous input.
+// keywords, alt and many go back after looking ahead
+auto record()
+{
+    auto count = [](size_t n, char) { return n + 1; };
+    auto path = many(apc::parsers::any<char>()).take_while([](char c) { return c != ' '; }).fold(size_t(0), count);
+
+    return sequence(
+        keywords("GET", "POST", "PUT", "DELETE"), unit(' '), path, unit(' '),
+        alt(sequence(unit('2'), lit("00")), sequence(unit('3'), lit("04")), sequence(unit('4'), lit("04"))),
+        unit('\n')
+    );
+}
+
+string make_record(size_t n)
+{
+    static const char* methods[] = { "GET", "POST", "PUT", "DELETE" };
+    static const char* statuses[] = { "200", "304", "404" };
+
+    return string(methods[n % 4]) + " /item/" + to_string(n * 7919 % 100000) + " " + statuses[n % 3] + "\n";
+}
+
+// A single pass source of records that never ends by itself,
+// it compares equal to the end after `limit` records
+class Records
+{
+public:
+
+    using iterator_category = input_iterator_tag;
+    using value_type = char;
+    using difference_type = ptrdiff_t;
+    using pointer = const char*;
+    using reference = char;
+
+    Records() : n(0), limit(0), k(0) {}
+
+    Records(size_t limit) : n(0), limit(limit), k(0), current(make_record(0)) {}
+
+    char operator*() const
+    {
+        return current[k];
+    }
+
+    Records& operator++()
+    {
+        if (++k == current.size())
+        {
+            k = 0;
+            current = make_record(++n);
+        }
+        return *this;
+    }
+
+    bool operator==(const Records& other) const
+    {
+        return limit == 0 ? other.n == other.limit : n == limit;
+    }
+
+    bool operator!=(const Records& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+
+    size_t n;
+    size_t limit;
+    size_t k;
+    string current;
+};
+
+int status = 0;
+
+template< typename I >
+void parse_all(I b, I e, size_t n_records)
+{
+    size_t taken = 0;
+    auto res = many(record()).for_each([&](auto&&) { taken++; }).parse(b, e);
+    if (!res.is_ok() || taken != n_records)
+    {
+        status = 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    string in;
+    size_t n_records = 0;
+    while (in.size() < bench::input_size(4))
+    {
+        in += make_record(n_records++);
+    }
+
+    bench::run("string", in.size(), n_records, [&]
+    {
+        parse_all(in.begin(), in.end(), n_records);
+    });
+
+    bench::run("buffered istream", in.size(), n_records, [&]
+    {
+        istringstream stream(in);
+        auto buffered = apc::input::buffered(stream);
+        parse_all(buffered.begin(), buffered.end(), n_records);
+    });
+
+    bench::run("buffered istreambuf_iterator", in.size(), n_records, [&]
+    {
+        istringstream stream(in);
+        auto buffered = apc::input::buffered(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+        parse_all(buffered.begin(), buffered.end(), n_records);
+    });
+
+    bench::run("buffered string", in.size(), n_records, [&]
+    {
+        auto buffered = apc::input::buffered(in.begin(), in.end());
+        parse_all(buffered.begin(), buffered.end(), n_records);
+    });
+
+    // memory must not grow with the length of the stream
+    for (size_t scale : { 1, 16 })
+    {
+        size_t capacity = 0;
+        bench::run("buffered stream, " + to_string(scale) + "x records", in.size() * scale, n_records * scale, [&]
+        {
+            auto buffered = apc::input::buffered(Records(n_records * scale), Records(), 1024);
+            parse_all(buffered.begin(), buffered.end(), n_records * scale);
+            capacity = buffered.capacity();
+        });
+
+        if (capacity != 1024)
+        {
+            printf("the ring grew to %zu elements\n", capacity);
+            status = 1;
+        }
+    }
+
+    if (status != 0)
+    {
+        printf("parsing failed\n");
+    }
+
+    return status;
+}
@@ -0,0 +1,116 @@
+#include <functional>
+#include <random>
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+constexpr auto space_class = one_of(" \t\r\n");
+constexpr auto ident_class = range('a', 'z') | range('A', 'Z') | range('0', '9') | one_of("_");
+
+// Words separated by runs of whitespace
+string generate(size_t size, mt19937& rng)
+{
+    const char spaces[] = " \t\n";
+
+    string ret;
+    while (ret.size() < size)
+    {
+        size_t word = 1 + rng() % 24;
+        for (size_t n = 0; n < word; n++)
+        {
+            ret += "abcdefghijklmnopqrstuvwxyz_0123456789"[rng() % 37];
+        }
+
+        size_t space = 1 + rng() % 16;
+        for (size_t n = 0; n < space; n++)
+        {
+            ret += spaces[rng() % 3];
+        }
+    }
+    return ret;
+}
+
+int status = 0;
+
+// Alternates between identifiers and whitespace until the end of the input
+template< typename Ident, typename Space >
+void bench_scan(const string& name, Ident ident, Space space, const string& in, size_t n_words)
+{
+    bench::run(name, in.size(), n_words, [&]
+    {
+        auto iter = in.begin();
+        while (iter != in.end())
+        {
+            auto word = ident.parse(iter, in.end());
+            if (!word.is_ok())
+            {
+                status = 1;
+                return;
+            }
+            iter = word.unwrap_ok().pos;
+
+            auto ws = space.parse(iter, in.end());
+            if (!ws.is_ok())
+            {
+                status = 1;
+                return;
+            }
+            iter = ws.unwrap_ok().pos;
+
+            bench::do_not_optimize(iter);
+        }
+    });
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    mt19937 rng(42);
+    string in = generate(bench::input_size(4), rng);
+
+    size_t n_words = 0;
+    auto word_ident = raw(many(apc::parsers::any<char>()).take_while(ident_class.set));
+    for (auto iter = in.begin(); iter != in.end(); n_words++)
+    {
+        iter = word_ident.parse(iter, in.end()).unwrap_ok().pos;
+        iter = span_of(space_class).parse(iter, in.end()).unwrap_ok().pos;
+    }
+
+    // how many_space and identifiers were written before, through std::function
+    function<bool(char&)> is_ident = [](char& c) { return ident_class.set(c); };
+    function<bool(char&)> is_space = [](char& c) { return space_class.set(c); };
+    bench_scan("take_while std::function, many_str",
+               many_str<char>().take_while(is_ident),
+               many_str<char>().take_while(is_space),
+               in, n_words);
+
+    bench_scan("take_while std::function, raw",
+               raw(many(apc::parsers::any<char>()).take_while(is_ident)),
+               raw(many(apc::parsers::any<char>()).take_while(is_space)),
+               in, n_words);
+
+    bench_scan("take_while lambda, many_str",
+               many_str<char>().take_while(ident_class.set),
+               many_space(),
+               in, n_words);
+
+    bench_scan("take_while lambda, raw",
+               raw(many(apc::parsers::any<char>()).take_while(ident_class.set)),
+               raw(many(apc::parsers::any<char>()).take_while(space_class.set)),
+               in, n_words);
+
+    bench_scan("span_of", span_of(ident_class), span_of(space_class), in, n_words);
+
+    if (status != 0)
+    {
+        printf("scanning failed\n");
+    }
+
+    return status;
+}
@@ -0,0 +1,114 @@
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// Runs the parser back to back over the whole input, one element per parse
+template< typename P >
+void bench_each(const string& name, P parser, const string& in, size_t element_size)
+{
+    size_t n = in.size() / element_size;
+
+    bench::run(name, in.size(), n, [&]
+    {
+        auto iter = in.begin();
+        for (size_t i = 0; i < n; i++)
+        {
+            iter = parser.parse(iter, in.end()).unwrap_ok().pos;
+        }
+        bench::do_not_optimize(iter);
+    });
+}
+
+// Runs the parser once over the whole input
+template< typename P >
+void bench_whole(const string& name, P parser, const string& in, size_t elements)
+{
+    bench::run(name, in.size(), elements, [&]
+    {
+        bench::do_not_optimize(parser.parse(in.begin(), in.end()).is_ok());
+    });
+}
+
+string repeat(const string& s, size_t total)
+{
+    string ret;
+    while (ret.size() + s.size() <= total)
+    {
+        ret += s;
+    }
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    const size_t size = 1 << 16;
+
+    string a = repeat("a", size);
+    string abc = repeat("abc", size);
+    string keyword = repeat("return", size);
+    string csv_row = repeat("a,b,c", size);
+
+    bench_each("unit", unit('a'), a, 1);
+    bench_each("lit", lit("return"), keyword, 6);
+    bench_each("alt 3 units, last matches", alt(unit('x'), unit('y'), unit('a')), a, 1);
+    bench_each("sequence 3 units", sequence(unit('a'), unit('b'), unit('c')), abc, 3);
+    bench_each("sequence 3 units with_delim", sequence(unit('a'), unit('b'), unit('c')).with_delim(unit(',')),
+               csv_row, 5);
+    bench_each("map", map(unit('a'), [](char c) { return c - 'a'; }), a, 1);
+
+    bench_whole("many unit", many(unit('a')), a, a.size());
+    bench_whole("many_str unit", many_str(unit('a')), a, a.size());
+    bench_whole("many unit with_delim", many(unit('a')).with_delim(unit(',')), repeat("a,", size), size / 2);
+    bench_whole("raw many unit", raw(many(unit('a'))), a, a.size());
+
+    // argument lists of a few elements each
+    auto letter = alt(unit('a'), unit('b'), unit('c'), unit('d'));
+    string lists = repeat("a,b,c,d;", size);
+    auto list_of = [&](auto elems) { return sequence(move(elems), unit(';')); };
+
+    bench_each("short lists, vector", list_of(many(letter).with_delim(unit(','))), lists, 8);
+    bench_each("short lists, reserve_hint(8)", list_of(many(letter).with_delim(unit(',')).reserve_hint(8)), lists, 8);
+    bench_each("short lists, inline_capacity<8>", list_of(many(letter).with_delim(unit(',')).inline_capacity<8>()), lists, 8);
+
+    // summing numeric fields, collected into a vector first and folded directly
+    auto digit = map(alt(
+        unit('0'), unit('1'), unit('2'), unit('3'), unit('4'),
+        unit('5'), unit('6'), unit('7'), unit('8'), unit('9')
+    ), [](char c) { return c - '0'; });
+    string numbers = repeat("7,", size);
+
+    bench::run("sum fields, many then add", numbers.size(), size / 2, [&]
+    {
+        auto res = many(digit).with_delim(unit(',')).parse(numbers.begin(), numbers.end());
+        long sum = 0;
+        for (int d : res.unwrap_ok().res)
+        {
+            sum += d;
+        }
+        bench::do_not_optimize(sum);
+    });
+
+    bench::run("sum fields, fold", numbers.size(), size / 2, [&]
+    {
+        auto res = many(digit).with_delim(unit(','))
+            .fold(0L, [](long sum, int d) { return sum + d; })
+            .parse(numbers.begin(), numbers.end());
+        bench::do_not_optimize(res.unwrap_ok().res);
+    });
+
+    bench::run("sum fields, for_each", numbers.size(), size / 2, [&]
+    {
+        long sum = 0;
+        many(digit).with_delim(unit(','))
+            .for_each([&](int d) { sum += d; })
+            .parse(numbers.begin(), numbers.end());
+        bench::do_not_optimize(sum);
+    });
+}
@@ -0,0 +1,35 @@
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// Parses every prefix of a record, as a streaming parser does when a record is
+// split between chunks. All but the last attempt end with end of input
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    auto field = many(alt(unit('a'), unit('b'), unit('c'))).at_least(1);
+    auto record = sequence(field, unit('='), field, unit(';'));
+    auto parser = many(record).at_least(1);
+
+    string in;
+    while (in.size() < 256)
+    {
+        in += "abcab=cabca;";
+    }
+
+    bench::run("end of input on every prefix", in.size(), in.size(), [&]
+    {
+        size_t n_eoi = 0;
+        for (auto end = in.begin(); end != in.end(); end++)
+        {
+            n_eoi += parser.parse(in.begin(), end).is_eoi();
+        }
+        bench::do_not_optimize(n_eoi);
+    });
+}
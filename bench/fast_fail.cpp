@@ -0,0 +1,88 @@
+#include <string>
+#include <vector>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// Ten string literals sharing a prefix, so the first byte doesn't rule any of
+// them out and every token fails about ten alternatives before it matches
+auto make_fields()
+{
+    return alt(
+        lit(string("field_alpha")), lit(string("field_bravo")),
+        lit(string("field_charlie")), lit(string("field_delta")),
+        lit(string("field_echo")), lit(string("field_foxtrot")),
+        lit(string("field_golf")), lit(string("field_hotel")),
+        lit(string("field_india")), lit(string("field_juliett"))
+    );
+}
+
+// "word name=1,... 42x" where the statement kinds differ only in the last
+// character, so every line fails seven statements at their very end and
+// each failure builds sequence and many errors around the leaf ones
+auto statement(char last)
+{
+    auto word = span_of(range('a', 'z')).at_least(1);
+    auto number = span_of(range('0', '9')).at_least(1);
+    auto pair = sequence(word, unit('='), number);
+    auto count = [](size_t n, auto&&) { return n + 1; };
+
+    return sequence(
+        word, unit(' '), many(pair).with_delim(unit(',')).at_least(1).fold(size_t(0), count),
+        unit(' '), sequence(number, unit(last))
+    );
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    auto parser = many(make_fields()).with_delim(unit(','));
+
+    string in;
+    size_t n = 0;
+    while (in.size() < 64 * 1024)
+    {
+        in += n == 0 ? "" : ",";
+        in += n % 2 == 0 ? "field_juliett" : "field_india";
+        n++;
+    }
+
+    bench::run("many alt 10 strings, detailed errors", in.size(), n, [&]
+    {
+        bench::do_not_optimize(parser.parse(in.begin(), in.end()).is_ok());
+    });
+
+    bench::run("many alt 10 strings, fast fail", in.size(), n, [&]
+    {
+        bench::do_not_optimize(parse_fast(parser, in.begin(), in.end()).is_ok());
+    });
+
+    auto statements = many(alt(
+        statement('a'), statement('b'), statement('c'), statement('d'),
+        statement('e'), statement('f'), statement('g'), statement('h')
+    )).with_delim(unit('\n')).fold(size_t(0), [](size_t n, auto&&) { return n + 1; });
+
+    string lines;
+    size_t n_lines = 0;
+    while (lines.size() < 64 * 1024)
+    {
+        lines += n_lines == 0 ? "" : "\n";
+        lines += "set width=10,height=20,depth=30 42h";
+        n_lines++;
+    }
+
+    bench::run("alt of nested sequences, detailed errors", lines.size(), n_lines, [&]
+    {
+        bench::do_not_optimize(statements.parse(lines.begin(), lines.end()).is_ok());
+    });
+
+    bench::run("alt of nested sequences, fast fail", lines.size(), n_lines, [&]
+    {
+        bench::do_not_optimize(parse_fast(statements, lines.begin(), lines.end()).is_ok());
+    });
+}
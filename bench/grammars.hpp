@@ -0,0 +1,59 @@
+#pragma once
+
+#include <apc.hpp>
+
+// Record grammars of the workloads, shared with the size report in bench/size
+
+namespace grammars
+{
+    using namespace std;
+    using namespace apc::parsers;
+
+    // Everything up to the first c
+    auto until(char c)
+    {
+        return raw(many(apc::parsers::any<char>()).take_while([c](char x) { return x != c; }));
+    }
+
+    auto digits()
+    {
+        return raw(many(alt(
+            unit('0'), unit('1'), unit('2'), unit('3'), unit('4'),
+            unit('5'), unit('6'), unit('7'), unit('8'), unit('9')
+        )).at_least(1));
+    }
+
+    auto csv_record()
+    {
+        auto field = raw(many(apc::parsers::any<char>()).take_while([](char c) { return c != ',' && c != '\n'; }));
+        return sequence(many(field).with_delim(unit(',')), unit('\n'));
+    }
+
+    // Flat objects with string, number and literal values
+    auto json_record()
+    {
+        auto str = sequence(unit('"'), until('"'), unit('"'));
+        auto number = sequence(alt(unit('-'), nop()), digits());
+        auto value = alt(
+            map(str, [](auto s) { return get<1>(s).size(); }),
+            map(number, [](auto n) { return get<1>(n).size(); }),
+            map(lit("true"), [](auto) { return size_t(1); }),
+            map(lit("false"), [](auto) { return size_t(0); }),
+            map(lit("null"), [](auto) { return size_t(0); })
+        );
+        auto member = sequence(str, lit(": "), value);
+
+        return sequence(unit('{'), many(member).with_delim(lit(", ")), unit('}'), unit('\n'));
+    }
+
+    // Common log format
+    auto log_record()
+    {
+        return sequence(
+            until(' '), lit(" - - ["), until(']'), lit("] \""),
+            keywords("GET", "POST", "PUT", "DELETE", "HEAD"), unit(' '),
+            until(' '), lit(" HTTP/1."), alt(unit('0'), unit('1')), lit("\" "),
+            digits(), unit(' '), digits(), unit('\n')
+        );
+    }
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+// The recursive sequence evaluator from before the flat one in parsers/sequence.hpp,
+// kept to compare their speed and code size
+
+#include <sstream>
+#include <tuple>
+#include <type_traits>
+
+#include <apc.hpp>
+
+namespace apc::parsers
+{
+    namespace legacy_sequence_ns
+    {
+        using namespace res;
+        using namespace misc;
+        using sequence_ns::SequenceErr;
+        using sequence_ns::SequenceErrCause;
+
+        template< bool build, typename P, typename I >
+        auto parse_element(P& parser, I b, I e)
+        {
+            if constexpr (build)
+            {
+                return parser.parse(b, e);
+            }
+            else
+            {
+                return parsers::recognize(parser, b, e);
+            }
+        }
+
+        // When build is false the values are not built and the result is NilOk
+        template< typename I, typename E, bool has_delim, bool build, typename D, typename P, typename... Ps >
+        auto sequence_impl(size_t n, I b, I e, D& delim, P& head, Ps&... tail)
+            -> Result<conditional_t<build, tuple<typename P::Ok, typename Ps::Ok...>, NilOk>, E, I>
+        {
+            using RetType = Result<conditional_t<build, tuple<typename P::Ok, typename Ps::Ok...>, NilOk>, E, I>;
+
+            I real_b = b;
+
+            if constexpr (has_delim)
+            {
+                if (n != 0)
+                {
+                    auto delim_res = parsers::recognize(delim, b, e)
+                        .map_err([n](auto& delim_err)
+                        {
+                            return err(
+                                E(0, SequenceErrCause::Delimiter, move(delim_err.err), n+1),
+                                delim_err.pos
+                            );
+                        })
+                        .visit_eoi([n](auto& delim_eoi)
+                        {
+                            delim_eoi.push("Sequence delimiter before position {}", n+1);
+                        });
+
+                    if (delim_res.is_ok())
+                    {
+                        real_b = delim_res.unwrap_ok().pos;
+                    }
+                    else
+                    {
+                        if (delim_res.is_err())
+                        {
+                            return delim_res.unwrap_err();
+                        }
+                        else
+                        {
+                            return delim_res.unwrap_eoi();
+                        }
+                    }
+                }
+            }
+
+            return parse_element<build>(head, real_b, e)
+                .map_err([n](auto& head_err)
+                {
+                    return err(
+                        E(0, SequenceErrCause::Parser, move(head_err.err), n+1),
+                        head_err.pos
+                    );
+                })
+                .visit_eoi([n](auto& head_eoi)
+                {
+                    head_eoi.push("Sequence position {}", n+1);
+                })
+                .fmap_ok([&](auto& head_ok) -> RetType
+                {
+                    if constexpr (sizeof...(Ps) == 0)
+                    {
+                        if constexpr (build)
+                        {
+                            return ok(make_tuple(move(head_ok.res)), head_ok.pos);
+                        }
+                        else
+                        {
+                            return ok(NilOk{}, head_ok.pos);
+                        }
+                    }
+                    else if constexpr (!build)
+                    {
+                        return sequence_impl<I, E, has_delim, build>(n+1, head_ok.pos, e, delim, tail...)
+                            .visit_err([&b](auto& tail_err)
+                            {
+                                tail_err.err.inner_offset += distance(b, tail_err.pos);
+                            });
+                    }
+                    else
+                    {
+                        return sequence_impl<I, E, has_delim, build>(n+1, head_ok.pos, e, delim, tail...)
+                            .map_ok([&head_ok](auto& tail_ok)
+                            {
+                                return ok(
+                                    tuple_cat(
+                                        make_tuple(move(head_ok.res)),
+                                        move(tail_ok.res)
+                                    ),
+                                    tail_ok.pos
+                                );
+                            })
+                            .visit_err([&b](auto& tail_err)
+                            {
+                                tail_err.err.inner_offset += distance(b, tail_err.pos);
+                            });
+                    }
+                });
+        }
+
+
+        template< bool has_delim, typename D, typename... Ps >
+        struct Sequence
+        {
+            tuple<Ps...> parsers;
+
+            using DelimType = conditional_t< has_delim,
+                                             D,
+                                             unsigned char
+                                             >;
+
+            DelimType delim;
+
+            using RetTypes = without_t_t<NilOk, typename Ps::Ok...>;
+
+            using Ok = conditional_t< tuple_size_v<RetTypes> == 1,
+                                      tuple_element_t<0, RetTypes>,
+                                      RetTypes
+                                      >;
+
+            using Err = change_wrapper_t<SequenceErr,
+                                         conditional_t< has_delim,
+                                                        remove_duplicates_t<typename D::Err, typename Ps::Err...>,
+                                                        remove_duplicates_t<typename Ps::Err...>
+                                                        >
+                                         >;
+
+            Sequence(DelimType delim, tuple<Ps...> parsers)
+                : parsers(move(parsers))
+                , delim(move(delim)) {}
+
+            // The delimiter only goes between the parsers so the first parser decides
+            first_set_ns::FirstSet first_set() const
+            {
+                return apc::parsers::first_set(get<0>(parsers));
+            }
+
+            template< typename NewD >
+            auto with_delim(NewD new_delim_parser)&&
+            {
+                return Sequence<true, NewD, Ps...>(
+                    move(new_delim_parser),
+                    move(parsers)
+                );
+            }
+
+            template< typename I >
+            Result<Ok, Err, I> parse(I b, I e)
+            {
+                auto res = apply([&b, &e, this](auto&... parsers)
+                {
+                    return sequence_impl<I, Err, has_delim, true>(0, b, e, delim, parsers...);
+                }, parsers);
+
+                return res
+                    .map_ok([](auto& res_ok)
+                    {
+                        if constexpr (is_same_v<Ok, RetTypes>)
+                        {
+                            return ok(
+                                move_ref_tuple(
+                                    without_t<NilOk>(
+                                        ref_tuple(res_ok.res)
+                                    )
+                                ),
+                                res_ok.pos
+                            );
+                        }
+                        else
+                        {
+                            return ok(
+                                move(get<0>(without_t<NilOk>(ref_tuple(res_ok.res)))),
+                                res_ok.pos
+                            );
+                        }
+                    });
+            }
+
+            // Same as parse but without building the tuple of values
+            template< typename I >
+            Result<NilOk, Err, I> recognize(I b, I e)
+            {
+                return apply([&b, &e, this](auto&... parsers)
+                {
+                    return sequence_impl<I, Err, has_delim, false>(0, b, e, delim, parsers...);
+                }, parsers);
+            }
+        };
+    }
+
+    template< typename... Ps >
+    auto legacy_sequence(Ps... parsers)
+    {
+        static_assert(sizeof...(Ps) > 0, "sequence parser requires at least one argument");
+        return legacy_sequence_ns::Sequence<false, nop_ns::Nop, Ps...>(0, make_tuple(move(parsers)...));
+    }
+
+}
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <random>
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+
+// Log lines of varying length
+string generate(size_t size, mt19937& rng)
+{
+    string ret;
+    while (ret.size() < size)
+    {
+        ret += "GET /item/" + to_string(rng() % 100000) + string(rng() % 60, 'x') + " 200\n";
+    }
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    mt19937 rng(42);
+    string text = generate(bench::input_size(64), rng);
+    size_t n_lines = count(text.begin(), text.end(), '\n');
+    int status = 0;
+
+    // what the first error of a parse pays
+    bench::run("first lookup, builds the index", text.size(), n_lines, [&]
+    {
+        apc::input::LineIndex index(text);
+        auto loc = index.locate(text.size() - 1);
+        if (loc.line != n_lines)
+        {
+            status = 1;
+        }
+        bench::do_not_optimize(loc);
+    });
+
+    bench::run("counting newlines with a loop, for comparison", text.size(), n_lines, [&]
+    {
+        size_t n = 0;
+        for (char c : text)
+        {
+            n += c == '\n';
+        }
+        bench::do_not_optimize(n);
+    });
+
+    apc::input::LineIndex index(text);
+    index.locate(size_t(0));
+
+    // the end of the text and anything past it are after the last newline
+    size_t last_line = n_lines + 1;
+    for (size_t offset : { text.size(), text.size() + 1, text.size() + 100000, size_t(-1) })
+    {
+        auto loc = index.locate(offset);
+        if (loc.line != last_line || loc.column != 1)
+        {
+            status = 1;
+        }
+    }
+
+    string last = "ab\ncd";
+    apc::input::LineIndex short_index(last);
+    auto end = short_index.locate(last.size());
+    auto past = short_index.locate(last.size() + 7);
+    if (end.line != 2 || end.column != 3 || past.line != 2 || past.column != 3)
+    {
+        status = 1;
+    }
+
+    const size_t n_lookups = 1000000;
+    bench::run("later lookups", 0, n_lookups, [&]
+    {
+        size_t offset = 0;
+        for (size_t n = 0; n < n_lookups; n++)
+        {
+            offset = (offset + 7919) % text.size();
+            bench::do_not_optimize(index.locate(offset));
+        }
+    });
+
+    if (status != 0)
+    {
+        printf("wrong line\n");
+    }
+
+    return status;
+}
@@ -0,0 +1,60 @@
+#include <string>
+#include <vector>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// Compares the contiguous fast path of Lit against the element-by-element loop
+template< typename P >
+void bench_lit(const string& name, P parser, const string& in)
+{
+    size_t n = in.size() / parser.lit.size();
+
+    bench::run(name + " fast", in.size(), n, [&]
+    {
+        auto iter = in.data();
+        auto end = in.data() + in.size();
+        for (size_t i = 0; i < n; i++)
+        {
+            iter = parser.parse_contiguous(iter, end).unwrap_ok().pos;
+        }
+        bench::do_not_optimize(iter);
+    });
+
+    bench::run(name + " generic", in.size(), n, [&]
+    {
+        auto iter = in.data();
+        auto end = in.data() + in.size();
+        for (size_t i = 0; i < n; i++)
+        {
+            iter = parser.parse_generic(iter, end).unwrap_ok().pos;
+        }
+        bench::do_not_optimize(iter);
+    });
+}
+
+string repeat(const string& s, size_t total)
+{
+    string ret;
+    while (ret.size() + s.size() <= total)
+    {
+        ret += s;
+    }
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    const size_t size = 1 << 22;
+
+    for (const char* kw : { ", ", "SELECT", "Content-Type: ", "application/x-www-form-urlencoded; charset=utf-8" })
+    {
+        bench_lit("lit \""s + kw + '"', lit(kw), repeat(kw, size));
+    }
+}
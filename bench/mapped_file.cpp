@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// Parses a generated file after reading it into a string and straight from
+// a mapping. The file is 256 MB unless --size is given, a few thousand MB
+// go past the page cache
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    const char* tmpdir = getenv("TMPDIR");
+    string path = string(tmpdir != nullptr ? tmpdir : "/tmp") + "/apc_bench_XXXXXX";
+    int fd = mkstemp(path.data());
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    const string line = "GET /index.html HTTP/1.1 200 OK 1234 bytes from 127.0.0.1 ...\n";
+    size_t n_lines = bench::input_size(256) / line.size();
+    {
+        ofstream out(path, ios::binary);
+        for (size_t n = 0; n < n_lines; n++)
+        {
+            out << line;
+        }
+    }
+    size_t size = n_lines * line.size();
+
+    auto parser = raw(many(lit(line)));
+    int status = 0;
+
+    bench::run("read into string", size, n_lines, [&]
+    {
+        ifstream in(path, ios::binary | ios::ate);
+        string text(in.tellg(), '\0');
+        in.seekg(0);
+        in.read(text.data(), text.size());
+
+        auto res = parser.parse(text.cbegin(), text.cend());
+        if (!res.is_ok() || res.unwrap_ok().res.size() != size)
+        {
+            status = 1;
+        }
+    });
+
+    bench::run("mapped file", size, n_lines, [&]
+    {
+        error_code ec;
+        auto file = apc::input::mapped_file(path, ec);
+        if (ec)
+        {
+            fprintf(stderr, "%s\n", ec.message().c_str());
+            status = 1;
+            return;
+        }
+
+        auto res = parser.parse(file.begin(), file.end());
+        if (!res.is_ok() || res.unwrap_ok().res.size() != size)
+        {
+            status = 1;
+        }
+    });
+
+    unlink(path.c_str());
+
+    if (status != 0)
+    {
+        printf("parsing the file failed\n");
+    }
+
+    return status;
+}
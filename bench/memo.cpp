@@ -0,0 +1,64 @@
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// level<n> = alt(sequence(level<n-1>, 'x'), sequence(level<n-1>, 'y')).
+// On "ay...y" the first alternative parses level<n-1> and then fails on 'x',
+// so without memoization the work doubles with every level.
+// The plain grammar also doubles in size, which keeps the depth small
+template< int n, bool memoize >
+auto level()
+{
+    if constexpr (n == 0)
+    {
+        return unit('a');
+    }
+    else
+    {
+        auto sub = [] {
+            if constexpr (memoize)
+            {
+                return memo(level<n-1, memoize>());
+            }
+            else
+            {
+                return level<n-1, memoize>();
+            }
+        }();
+
+        return alt(sequence(sub, unit('x')), sequence(sub, unit('y')));
+    }
+}
+
+template< int n >
+void bench_level()
+{
+    string in = "a" + string(n, 'y');
+
+    auto plain = level<n, false>();
+    auto memoized = level<n, true>();
+
+    bench::run("ambiguous depth " + to_string(n) + ", plain", in.size(), in.size(), [&]
+    {
+        bench::do_not_optimize(plain.parse(in.begin(), in.end()).is_ok());
+    });
+
+    bench::run("ambiguous depth " + to_string(n) + ", memo", in.size(), in.size(), [&]
+    {
+        bench::do_not_optimize(parse_memoized(memoized, in.begin(), in.end()).is_ok());
+    });
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    bench_level<4>();
+    bench_level<8>();
+    bench_level<12>();
+}
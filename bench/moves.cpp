@@ -0,0 +1,98 @@
+#include <memory>
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+size_t copies = 0;
+
+// Value that counts how often it is copied
+struct Counted
+{
+    char c;
+
+    Counted(char c) : c(c) {}
+
+    Counted(const Counted& other) : c(other.c)
+    {
+        copies++;
+    }
+
+    Counted(Counted&& other) = default;
+
+    Counted& operator=(const Counted& other)
+    {
+        c = other.c;
+        copies++;
+        return *this;
+    }
+
+    Counted& operator=(Counted&& other) = default;
+};
+
+// Binary tree nodes that can only be moved
+struct Node
+{
+    char c;
+    unique_ptr<Node> left;
+    unique_ptr<Node> right;
+};
+
+template< typename F >
+auto value(char c, F f)
+{
+    return map(unit(c), f);
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    string in;
+    for (size_t n = 0; in.size() < bench::input_size(1); n++)
+    {
+        in += n % 3 == 0 ? "ab," : "ba,";
+    }
+    size_t n_pairs = in.size() / 3;
+
+    // every value goes through map, alt, sequence and many
+    auto counted = [](char c) { return Counted(c); };
+    auto pairs = many(sequence(
+        alt(value('a', counted), value('b', counted)),
+        map(alt(value('a', counted), value('b', counted)), [](Counted c) { return c; }),
+        hide(unit(','))
+    ));
+
+    bench::run("copy counting values", in.size(), n_pairs, [&]
+    {
+        bench::do_not_optimize(pairs.parse(in.begin(), in.end()).unwrap_ok().res.size());
+    });
+
+    auto leaf = [](char c) { return make_unique<Node>(Node{ c, nullptr, nullptr }); };
+    auto nodes = many(map(
+        sequence(
+            alt(value('a', leaf), value('b', leaf)),
+            alt(value('a', leaf), value('b', leaf))
+        ),
+        [](auto children)
+        {
+            return make_unique<Node>(Node{ '+', move(get<0>(children)), move(get<1>(children)) });
+        }
+    )).with_delim(unit(','));
+
+    bench::run("move-only nodes", in.size(), n_pairs, [&]
+    {
+        bench::do_not_optimize(nodes.parse(in.begin(), in.end()).unwrap_ok().res.size());
+    });
+
+    // values must be built once and then only moved
+    if (copies != 0)
+    {
+        printf("%zu values were copied\n", copies);
+        return 1;
+    }
+}
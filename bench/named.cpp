@@ -0,0 +1,128 @@
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+#include "grammars.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// Same grammar as grammars::json_record with every rule named.
+// Built with BENCH_FLAGS=-DAPC_PROFILE it shows the profile of a grammar
+auto named_json_record()
+{
+    auto str = named(sequence(unit('"'), grammars::until('"'), unit('"')), "string");
+    auto number = named(sequence(alt(unit('-'), nop()), named(grammars::digits(), "digits")), "number");
+    auto value = named(alt(
+        map(str, [](auto s) { return get<1>(s).size(); }),
+        map(number, [](auto n) { return get<1>(n).size(); }),
+        map(named(lit("true"), "true"), [](auto) { return size_t(1); }),
+        map(named(lit("false"), "false"), [](auto) { return size_t(0); }),
+        map(named(lit("null"), "null"), [](auto) { return size_t(0); })
+    ), "value");
+    auto member = named(sequence(str, lit(": "), value), "member");
+
+    return named(sequence(unit('{'), many(member).with_delim(lit(", ")), unit('}'), unit('\n')), "record");
+}
+
+string generate(size_t size, mt19937& rng)
+{
+    string ret;
+    for (size_t n = 0; ret.size() < size; n++)
+    {
+        ret += "{\"id\": " + to_string(n) + ", \"name\": \"user" + to_string(rng() % 1000) + "\"";
+        ret += ", \"score\": -" + to_string(rng() % 100000);
+        ret += rng() % 2 == 0 ? ", \"active\": true" : ", \"active\": false";
+        ret += ", \"parent\": null}\n";
+    }
+    return ret;
+}
+
+// A parser that throws must leave the probes and the profiler as they were,
+// so that the next parse is counted normally. Matters when built with
+// APC_INSTRUMENT or APC_PROFILE
+bool survives_throw()
+{
+    bool fail = true;
+    auto record = named(sequence(unit('a'), named(map(unit('b'), [&](char c)
+    {
+        if (fail)
+        {
+            throw runtime_error("b");
+        }
+        return c;
+    }), "b")), "ab");
+
+    string in = "ab";
+    try
+    {
+        record.parse(in.begin(), in.end());
+        return false;
+    }
+    catch (const runtime_error&) {}
+
+    fail = false;
+    bool ok = record.parse(in.begin(), in.end()).is_ok();
+
+#if defined(APC_INSTRUMENT)
+    ok = ok && apc::instrument::thread().children == nullptr && *apc::instrument::thread().label == '\0';
+#endif
+
+#if defined(APC_PROFILE)
+    ok = ok && apc::profile::thread().depth == 0 && apc::profile::thread().current == 0;
+#endif
+
+    return ok;
+}
+
+int status = 0;
+
+template< typename P >
+void bench_records(const string& name, P record, const string& in)
+{
+    size_t n_records = count(in.begin(), in.end(), '\n');
+
+    bench::run(name, in.size(), n_records, [&]
+    {
+        auto iter = in.begin();
+        while (iter != in.end())
+        {
+            auto res = record.parse(iter, in.end());
+            if (!res.is_ok())
+            {
+                status = 1;
+                return;
+            }
+
+            bench::do_not_optimize(res.unwrap_ok().res);
+            iter = res.unwrap_ok().pos;
+        }
+    });
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    if (!survives_throw())
+    {
+        printf("a parse after an exception failed\n");
+        return 1;
+    }
+
+    mt19937 rng(42);
+    string in = generate(bench::input_size(4), rng);
+
+    bench_records("json", grammars::json_record(), in);
+    bench_records("json, named rules", named_json_record(), in);
+
+    if (status != 0)
+    {
+        printf("parsing failed\n");
+    }
+
+    return status;
+}
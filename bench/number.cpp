@@ -0,0 +1,154 @@
+#include <charconv>
+#include <deque>
+#include <random>
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+#include "grammars.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// Telemetry records, mostly numbers
+string generate(size_t size, mt19937_64& rng)
+{
+    string ret;
+    while (ret.size() < size)
+    {
+        ret += to_string(1700000000000 + rng() % 100000000000) + "," + to_string(rng() % 100000)
+             + "," + to_string(int64_t(rng() % 2000000) - 1000000) + "," + to_string(double(rng() % 1000000) / 1000) + "\n";
+    }
+    return ret;
+}
+
+// Scans the digits, then converts them again
+auto with_digits()
+{
+    auto to_i64 = [](auto s)
+    {
+        int64_t v = 0;
+        from_chars(s.data(), s.data() + s.size(), v);
+        return v;
+    };
+
+    auto signed_digits = raw(sequence(alt(unit('-'), nop()), grammars::digits()));
+    auto decimal = raw(sequence(alt(unit('-'), nop()), grammars::digits(), unit('.'), grammars::digits()));
+
+    return sequence(
+        map(grammars::digits(), to_i64), unit(','), map(grammars::digits(), to_i64), unit(','),
+        map(signed_digits, to_i64), unit(','),
+        map(decimal, [](auto s) { return stod(string(s)); }), unit('\n')
+    );
+}
+
+auto with_numbers()
+{
+    return sequence(
+        integer<int64_t>(), unit(','), integer<uint32_t>(), unit(','), integer<int32_t>(), unit(','),
+        floating(), unit('\n')
+    );
+}
+
+int status = 0;
+
+template< typename P >
+void bench_records(const string& name, P record, const string& in)
+{
+    size_t n_records = count(in.begin(), in.end(), '\n');
+
+    bench::run(name, in.size(), n_records, [&]
+    {
+        const char* iter = in.data();
+        const char* end = in.data() + in.size();
+        while (iter != end)
+        {
+            auto res = record.parse(iter, end);
+            if (!res.is_ok())
+            {
+                status = 1;
+                return;
+            }
+
+            bench::do_not_optimize(res.unwrap_ok().res);
+            iter = res.unwrap_ok().pos;
+        }
+    });
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    mt19937_64 rng(42);
+    string records = generate(bench::input_size(4), rng);
+
+    bench_records("records, digits and map", with_digits(), records);
+    bench_records("records, integer and floating", with_numbers(), records);
+
+    // 64 bit integers of every length
+    string ints;
+    size_t n_ints = 0;
+    while (ints.size() < bench::input_size(4))
+    {
+        ints += to_string(rng() >> (rng() % 64)) + ",";
+        n_ints++;
+    }
+
+    bench::run("integer<uint64_t>", ints.size(), n_ints, [&]
+    {
+        auto res = many(integer<uint64_t>()).with_delim(unit(',')).fold(uint64_t(0), [](uint64_t a, uint64_t b) { return a ^ b; })
+            .parse(ints.data(), ints.data() + ints.size());
+        if (!res.is_ok())
+        {
+            status = 1;
+        }
+        bench::do_not_optimize(res);
+    });
+
+    bench::run("from_chars loop, for comparison", ints.size(), n_ints, [&]
+    {
+        uint64_t acc = 0;
+        for (const char* iter = ints.data(); iter != ints.data() + ints.size(); iter++)
+        {
+            uint64_t v = 0;
+            iter = from_chars(iter, ints.data() + ints.size(), v).ptr;
+            acc ^= v;
+        }
+        bench::do_not_optimize(acc);
+    });
+
+    // floating on input that isn't contiguous copies every number to the stack
+    string floats;
+    size_t n_floats = 0;
+    while (floats.size() < bench::input_size(1))
+    {
+        floats += to_string(double(rng() % 100000000) / 1000) + ",";
+        n_floats++;
+    }
+
+    auto sum_floats = [](auto b, auto e)
+    {
+        auto res = many(floating()).with_delim(unit(',')).fold(0.0, [](double a, double b) { return a + b; }).parse(b, e);
+        return res.is_ok() ? res.unwrap_ok().res : -1.0;
+    };
+
+    deque<char> split_floats(floats.begin(), floats.end());
+    double expected = sum_floats(floats.data(), floats.data() + floats.size());
+
+    bench::run("floating on a deque", floats.size(), n_floats, [&]
+    {
+        if (sum_floats(split_floats.cbegin(), split_floats.cend()) != expected)
+        {
+            status = 1;
+        }
+    });
+
+    if (status != 0)
+    {
+        printf("parsing failed\n");
+    }
+
+    return status;
+}
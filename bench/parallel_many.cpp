@@ -0,0 +1,98 @@
+#include <random>
+#include <string>
+#include <thread>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// CSV fields, quoted fields may contain commas, newlines and doubled quotes
+auto csv_record()
+{
+    auto quoted = raw(sequence(
+        unit('"'),
+        many(alt(hide(lit("\"\"")), hide(span_of(~one_of("\"")).at_least(1)))),
+        unit('"')
+    ));
+    auto field = alt(quoted, span_of(~one_of(",\n\"")));
+
+    return many(field).with_delim(unit(','));
+}
+
+string generate(size_t size, mt19937& rng)
+{
+    string ret;
+    for (size_t n = 0; ret.size() < size; n++)
+    {
+        ret += to_string(n) + ",name" + to_string(rng() % 1000) + ",";
+        ret += rng() % 4 == 0 ? "\"multi\nline, \"\"quoted\"\"\"" : to_string(rng() % 100000);
+        ret += "," + string(rng() % 16, 'x') + "\n";
+    }
+    return ret;
+}
+
+// parallel_many has to return what many returns, records and end position
+bool same_as_many(const string& in, size_t n_threads)
+{
+    auto expected = many(csv_record()).with_delim(unit('\n')).parse(in.begin(), in.end());
+    auto got = parallel_many(csv_record(), unit('\n'), n_threads).quoted().min_chunk(64).parse(in.begin(), in.end());
+
+    if (!expected.is_ok() || !got.is_ok())
+    {
+        return expected.is_ok() == got.is_ok() && expected.is_eoi() == got.is_eoi();
+    }
+
+    return expected.unwrap_ok().res == got.unwrap_ok().res
+        && expected.unwrap_ok().pos == got.unwrap_ok().pos;
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    mt19937 rng(42);
+    string in = generate(bench::input_size(16), rng);
+
+    // thread counts that don't divide the input evenly, on inputs of many sizes
+    for (size_t size : { 0, 1, 100, 4096, 100000 })
+    {
+        string sample = generate(size, rng);
+        for (size_t n_threads : { 1, 2, 3, 4, 7 })
+        {
+            if (!same_as_many(sample, n_threads))
+            {
+                printf("parallel_many differs from many: %zu bytes, %zu threads\n", size, n_threads);
+                return 1;
+            }
+        }
+    }
+
+    auto sequential = many(csv_record()).with_delim(unit('\n'));
+    size_t n_records = sequential.parse(in.begin(), in.end()).unwrap_ok().res.size();
+
+    bench::run("many with_delim", in.size(), n_records, [&]
+    {
+        bench::do_not_optimize(sequential.parse(in.begin(), in.end()).is_ok());
+    });
+
+    size_t max_threads = max(1u, thread::hardware_concurrency());
+
+    for (size_t n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+    {
+        auto parallel = parallel_many(csv_record(), unit('\n'), n_threads).quoted();
+        if (!same_as_many(in, n_threads))
+        {
+            printf("parallel_many differs from many: %zu threads\n", n_threads);
+            return 1;
+        }
+
+        string suffix = n_threads == 1 ? " thread" : " threads";
+        bench::run("parallel_many, " + to_string(n_threads) + suffix, in.size(), n_records, [&]
+        {
+            bench::do_not_optimize(parallel.parse(in.begin(), in.end()).is_ok());
+        });
+    }
+}
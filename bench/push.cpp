@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// Counts how often the record is parsed
+template< typename P >
+struct Counted
+{
+    P parser;
+    size_t* calls;
+
+    using Ok = typename P::Ok;
+    using Err = typename P::Err;
+
+    template< typename I >
+    auto parse(I b, I e)
+    {
+        (*calls)++;
+        return parser.parse(b, e);
+    }
+};
+
+// Parses a CSV-like stream once as a whole and once fed in 4 KB chunks and
+// checks that both see the same records. The input is 64 MB unless --size is
+// given, `bench/push --size=1024` runs the 1 GB case
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    size_t chunk_size = 4096;
+
+    auto field = raw(many(alt(
+        unit('a'), unit('b'), unit('c'), unit('d'), unit('e'), unit('f'),
+        unit('0'), unit('1'), unit('2'), unit('3'), unit('4'),
+        unit('5'), unit('6'), unit('7'), unit('8'), unit('9')
+    )).at_least(1));
+    auto record = sequence(field, unit(','), field, unit(','), field, unit('\n'));
+
+    string in;
+    size_t size = bench::input_size(64);
+    in.reserve(size);
+    for (size_t n = 0; in.size() + 64 <= size; n++)
+    {
+        string id = to_string(n % 100000);
+        in += "abc" + id + ",";
+        in += string(1 + n % 23, "abcdef"[n % 6]) + ",";
+        in += id + "fed\n";
+    }
+
+    size_t n_records = count(in.begin(), in.end(), '\n');
+
+    struct Summary
+    {
+        size_t records = 0;
+        size_t bytes = 0;
+
+        void add(const tuple<string_view, char, string_view, char, string_view, char>& rec)
+        {
+            records++;
+            bytes += get<0>(rec).size() + get<2>(rec).size() + get<4>(rec).size();
+        }
+    };
+
+    Summary whole;
+    bench::run("records, contiguous", in.size(), n_records, [&]
+    {
+        whole = Summary();
+
+        const char* iter = in.data();
+        const char* end = in.data() + in.size();
+        while (iter != end)
+        {
+            auto res = record.parse(iter, end);
+            whole.add(res.unwrap_ok().res);
+            iter = res.unwrap_ok().pos;
+        }
+    });
+
+    Summary chunked;
+    bench::run("records, fed in 4 KB chunks", in.size(), n_records, [&]
+    {
+        chunked = Summary();
+
+        auto parser = push(record, [&](auto rec) { chunked.add(rec); });
+        for (size_t pos = 0; pos < in.size(); pos += chunk_size)
+        {
+            parser.feed(string_view(in).substr(pos, chunk_size));
+        }
+        bench::do_not_optimize(parser.finish().is_ok());
+    });
+
+    if (whole.records != chunked.records || whole.bytes != chunked.bytes)
+    {
+        printf("chunked parse differs: %zu records %zu bytes, expected %zu records %zu bytes\n",
+               chunked.records, chunked.bytes, whole.records, whole.bytes);
+        return 1;
+    }
+
+    // One 16 MB record is parsed again only when the unfinished part doubled,
+    // a few dozen times instead of once per chunk
+    string long_record = "abc," + string(16 << 20, 'a') + ",fed\n";
+    size_t calls = 0;
+    size_t delivered = 0;
+
+    bench::run("one 16 MB record, fed in 4 KB chunks", long_record.size(), 1, [&]
+    {
+        calls = 0;
+        delivered = 0;
+
+        auto parser = push(Counted<decltype(record)>{ record, &calls }, [&](auto) { delivered++; }).record_end('\n');
+        for (size_t pos = 0; pos < long_record.size(); pos += chunk_size)
+        {
+            parser.feed(string_view(long_record).substr(pos, chunk_size));
+        }
+        bench::do_not_optimize(parser.finish().is_ok());
+    });
+
+    if (delivered != 1 || calls > 64)
+    {
+        printf("long record: %zu records in %zu parses, expected 1 record in at most 64\n", delivered, calls);
+        return 1;
+    }
+}
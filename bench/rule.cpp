@@ -0,0 +1,160 @@
+#include <random>
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+#include "grammars.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+// JSON values nested in arrays and objects, counts the scalars.
+// The grammar refers to the rule, so it has to stay where it was built
+struct Json
+{
+    rule<size_t> value;
+
+    Json()
+    {
+        auto count = [](auto) { return size_t(1); };
+        auto sum = [](size_t a, size_t b) { return a + b; };
+
+        auto str = sequence(unit('"'), grammars::until('"'), unit('"'));
+        auto number = sequence(alt(unit('-'), nop()), grammars::digits());
+
+        auto array = map(
+            sequence(unit('['), many(value.ref()).with_delim(lit(", ")).fold(size_t(0), sum), unit(']')),
+            [](auto a) { return get<1>(a); });
+
+        auto member = map(sequence(str, lit(": "), value.ref()), [](auto m) { return get<2>(m); });
+        auto object = map(
+            sequence(unit('{'), many(member).with_delim(lit(", ")).fold(size_t(0), sum), unit('}')),
+            [](auto o) { return get<1>(o); });
+
+        value.define(alt(
+            object,
+            array,
+            map(str, count),
+            map(number, count),
+            map(lit("true"), count),
+            map(lit("false"), count),
+            map(lit("null"), count)
+        ));
+    }
+};
+
+// Same records as bench/named.cpp, flat enough for grammars::json_record
+string generate_flat(size_t size, mt19937& rng)
+{
+    string ret;
+    for (size_t n = 0; ret.size() < size; n++)
+    {
+        ret += "{\"id\": " + to_string(n) + ", \"name\": \"user" + to_string(rng() % 1000) + "\"";
+        ret += ", \"score\": -" + to_string(rng() % 100000);
+        ret += rng() % 2 == 0 ? ", \"active\": true" : ", \"active\": false";
+        ret += ", \"parent\": null}\n";
+    }
+    return ret;
+}
+
+string nested_value(size_t depth, mt19937& rng)
+{
+    switch (depth == 0 ? rng() % 3 : rng() % 5)
+    {
+        case 0: return to_string(rng() % 100000);
+        case 1: return "\"item" + to_string(rng() % 1000) + "\"";
+        case 2: return rng() % 2 == 0 ? "true" : "null";
+        case 3:
+        {
+            string ret = "[";
+            for (size_t n = rng() % 4; n-- > 0;)
+            {
+                ret += nested_value(depth - 1, rng) + (n != 0 ? ", " : "");
+            }
+            return ret + "]";
+        }
+        default:
+        {
+            string ret = "{";
+            for (size_t n = rng() % 4; n-- > 0;)
+            {
+                ret += "\"k" + to_string(n) + "\": " + nested_value(depth - 1, rng) + (n != 0 ? ", " : "");
+            }
+            return ret + "}";
+        }
+    }
+}
+
+// Objects with arrays and objects up to six levels deep
+string generate_nested(size_t size, mt19937& rng)
+{
+    string ret;
+    for (size_t n = 0; ret.size() < size; n++)
+    {
+        ret += "{\"id\": " + to_string(n) + ", \"data\": " + nested_value(6, rng) + "}\n";
+    }
+    return ret;
+}
+
+int status = 0;
+
+template< typename P >
+void bench_records(const string& name, P record, const string& in)
+{
+    size_t n_records = count(in.begin(), in.end(), '\n');
+
+    bench::run(name, in.size(), n_records, [&]
+    {
+        const char* iter = in.data();
+        const char* end = in.data() + in.size();
+        while (iter != end)
+        {
+            auto res = record.parse(iter, end);
+            if (!res.is_ok())
+            {
+                status = 1;
+                return;
+            }
+
+            bench::do_not_optimize(res.unwrap_ok().res);
+            iter = res.unwrap_ok().pos;
+        }
+    });
+}
+
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    mt19937 rng(42);
+    string flat = generate_flat(bench::input_size(4), rng);
+    string nested = generate_nested(bench::input_size(4), rng);
+
+    Json json;
+    auto record = sequence(json.value.ref(), unit('\n'));
+
+    bench_records("flat json, fixed grammar", grammars::json_record(), flat);
+    bench_records("flat json, rule", record, flat);
+    bench_records("nested json, rule", record, nested);
+
+    // must fail at the depth limit instead of running out of stack
+    string deep = string(100000, '[') + string(100000, ']');
+    bench::run("100k nested arrays, rejected", deep.size(), 1, [&]
+    {
+        auto res = json.value.parse(deep.data(), deep.data() + deep.size());
+        if (res.is_ok())
+        {
+            status = 1;
+        }
+
+        bench::do_not_optimize(res);
+    });
+
+    if (status != 0)
+    {
+        printf("parsing failed\n");
+    }
+
+    return status;
+}
@@ -0,0 +1,69 @@
+#include <string>
+#include <utility>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+#include "legacy_sequence.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+
+template< size_t >
+auto element()
+{
+    return apc::parsers::any<char>();
+}
+
+// A sequence of N parsers of single characters
+template< size_t... Ns >
+auto flat(index_sequence<Ns...>)
+{
+    return sequence(element<Ns>()...);
+}
+
+template< size_t... Ns >
+auto legacy(index_sequence<Ns...>)
+{
+    return legacy_sequence(element<Ns>()...);
+}
+
+// Parses the input as consecutive runs of N characters
+template< typename P >
+void bench_sequence(const string& name, P parser, size_t n, const string& in)
+{
+    size_t n_sequences = in.size() / n;
+
+    bench::run(name + ", " + to_string(n) + (n == 1 ? " element" : " elements"), in.size(), in.size(), [&]
+    {
+        auto iter = in.begin();
+        for (size_t k = 0; k < n_sequences; k++)
+        {
+            auto res = parser.parse(iter, in.end());
+            iter = res.unwrap_ok().pos;
+            bench::do_not_optimize(res.unwrap_ok().res);
+        }
+    });
+}
+
+template< size_t N >
+void bench_length(const string& in)
+{
+    bench_sequence("legacy sequence", legacy(make_index_sequence<N>()), N, in);
+    bench_sequence("sequence", flat(make_index_sequence<N>()), N, in);
+}
+
+// Elements are the characters, so ns/element is the cost of one step of the sequence
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    string in(bench::input_size(1), 'a');
+
+    bench_length<1>(in);
+    bench_length<2>(in);
+    bench_length<4>(in);
+    bench_length<8>(in);
+    bench_length<16>(in);
+    bench_length<32>(in);
+}
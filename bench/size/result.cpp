@@ -0,0 +1,43 @@
+#include <cstdio>
+#include <string>
+
+#include <apc.hpp>
+
+#include "../grammars.hpp"
+
+// Run by make bench-size with and without APC_COMPACT_RESULT, prints the size
+// of the results of the workload grammars and of their success and failure parts
+
+using namespace std;
+using namespace apc::parsers;
+using namespace grammars;
+
+template< typename P >
+void report(const char* name, P parser)
+{
+    using I = const char*;
+    using R = decltype(parser.parse(declval<I>(), declval<I>()));
+
+    printf("%-12s %8zu %8zu %8zu %8zu\n",
+           name,
+           sizeof(R),
+           sizeof(apc::res::Ok<typename P::Ok, I>),
+           sizeof(apc::res::Err<typename P::Err, I>),
+           sizeof(apc::res::EOI));
+}
+
+int main()
+{
+#if defined(APC_COMPACT_RESULT)
+    printf("compact results\n");
+#else
+    printf("inline results\n");
+#endif
+
+    printf("%-12s %8s %8s %8s %8s\n", "grammar", "Result", "Ok", "Err", "EOI");
+
+    report("unit", unit('a'));
+    report("csv", csv_record());
+    report("json subset", json_record());
+    report("apache log", log_record());
+}
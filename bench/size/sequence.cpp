@@ -0,0 +1,43 @@
+#include <utility>
+
+#include <apc.hpp>
+
+#include "../legacy_sequence.hpp"
+
+// Compiled once per length by make bench-size, the size of the object file is
+// the code generated for parse and recognize of a sequence of SEQUENCE_LENGTH parsers
+
+#ifndef SEQUENCE_LENGTH
+#define SEQUENCE_LENGTH 8
+#endif
+
+using namespace std;
+using namespace apc::parsers;
+
+template< size_t >
+auto element()
+{
+    return unit('a');
+}
+
+template< size_t... Ns >
+auto make(index_sequence<Ns...>)
+{
+#ifdef LEGACY_SEQUENCE
+    return legacy_sequence(element<Ns>()...);
+#else
+    return sequence(element<Ns>()...);
+#endif
+}
+
+using Parser = decltype(make(make_index_sequence<SEQUENCE_LENGTH>()));
+
+bool parse(Parser& parser, const char* b, const char* e)
+{
+    return parser.parse(b, e).is_ok();
+}
+
+bool recognize(Parser& parser, const char* b, const char* e)
+{
+    return parser.recognize(b, e).is_ok();
+}
@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include <apc.hpp>
+
+#include "bench.hpp"
+#include "grammars.hpp"
+
+using namespace std;
+using namespace apc::parsers;
+using namespace grammars;
+
+string generate_csv(size_t size, mt19937& rng)
+{
+    string ret;
+    for (size_t n = 0; ret.size() < size; n++)
+    {
+        ret += to_string(n) + ",name" + to_string(rng() % 1000) + ",";
+        ret += to_string(rng() % 100000) + "," + string(rng() % 16, 'x') + ",end\n";
+    }
+    return ret;
+}
+
+string generate_json(size_t size, mt19937& rng)
+{
+    string ret;
+    for (size_t n = 0; ret.size() < size; n++)
+    {
+        ret += "{\"id\": " + to_string(n) + ", \"name\": \"user" + to_string(rng() % 1000) + "\"";
+        ret += ", \"score\": -" + to_string(rng() % 100000);
+        ret += rng() % 2 == 0 ? ", \"active\": true" : ", \"active\": false";
+        ret += ", \"parent\": null}\n";
+    }
+    return ret;
+}
+
+string generate_log(size_t size, mt19937& rng)
+{
+    const char* methods[] = { "GET", "POST", "PUT", "DELETE", "HEAD" };
+
+    string ret;
+    while (ret.size() < size)
+    {
+        ret += "10." + to_string(rng() % 256) + "." + to_string(rng() % 256) + ".1 - - ";
+        ret += "[10/Oct/2000:13:" + to_string(10 + rng() % 50) + ":36 -0700] \"";
+        ret += string(methods[rng() % 5]) + " /static/" + to_string(rng() % 10000) + ".gif HTTP/1.";
+        ret += to_string(rng() % 2) + "\" " + to_string(200 + rng() % 300) + " " + to_string(rng() % 100000) + "\n";
+    }
+    return ret;
+}
+
+int status = 0;
+
+// Parses the records of the input one after another
+template< typename P >
+void bench_workload(const string& name, P record, const string& in)
+{
+    size_t n_records = count(in.begin(), in.end(), '\n');
+
+    bench::run(name, in.size(), n_records, [&]
+    {
+        auto iter = in.begin();
+        while (iter != in.end())
+        {
+            auto res = record.parse(iter, in.end());
+            if (!res.is_ok())
+            {
+                status = 1;
+                return;
+            }
+
+            bench::do_not_optimize(res.unwrap_ok().res);
+            iter = res.unwrap_ok().pos;
+        }
+    });
+}
+
+// Input sizes are 4 MB unless --size is given
+int main(int argc, char** argv)
+{
+    bench::init(argc, argv);
+
+    size_t size = bench::input_size(4);
+    mt19937 rng(42);
+
+    bench_workload("csv", csv_record(), generate_csv(size, rng));
+    bench_workload("json subset", json_record(), generate_json(size, rng));
+    bench_workload("apache log", log_record(), generate_log(size, rng));
+
+    if (status != 0)
+    {
+        printf("a workload failed to parse\n");
+    }
+
+    return status;
+}
@@ -0,0 +1,79 @@
+#include <string_view>
+#include <tuple>
+
+#include <apc.hpp>
+
+// Grammars that run at compile time, needs C++20. Every static_assert is
+// checked by the compiler, so building this file is the test
+
+using namespace std;
+using namespace apc::parsers;
+
+struct Route
+{
+    string_view method;
+    string_view path;
+    size_t port = 0;
+};
+
+constexpr auto number()
+{
+    return map(many(range('0', '9')).fixed_capacity<8>().at_least(1), [](auto digits)
+    {
+        size_t n = 0;
+        for (char d : digits)
+        {
+            n = n * 10 + size_t(d - '0');
+        }
+        return n;
+    });
+}
+
+constexpr auto route()
+{
+    return map(sequence(
+        alt(lit("GET"), lit("POST")), hide(unit(' ')),
+        raw(span_of(~one_of(" \n")).at_least(1)), hide(unit(' ')),
+        number(), hide(unit('\n'))
+    ), [](auto t) { return Route{ get<0>(t), get<1>(t), get<2>(t) }; });
+}
+
+constexpr auto routes = parse_constexpr(many(route()).fixed_capacity<4>(),
+    "GET /a 80\n"
+    "POST /b/c 8080\n");
+
+static_assert(routes.size() == 2);
+static_assert(routes[0].method == "GET" && routes[0].path == "/a" && routes[0].port == 80);
+static_assert(routes[1].method == "POST" && routes[1].path == "/b/c" && routes[1].port == 8080);
+
+// A full static_vector stops many like at_most, the rest of the input is left
+constexpr bool stops_when_full = []
+{
+    string_view in = "abc";
+    auto res = many(one_of("abc")).fixed_capacity<2>().parse(in.data(), in.data() + in.size());
+    return res.is_ok() && res.unwrap_ok().res.size() == 2 && res.unwrap_ok().pos == in.data() + 2;
+}();
+static_assert(stops_when_full);
+
+// vectors work as long as they don't end up in the result
+constexpr size_t n_items = parse_constexpr(
+    map(many(sequence(one_of("abc"), hide(unit(',')))), [](auto items) { return items.size(); }),
+    "a,b,c,");
+static_assert(n_items == 3);
+
+constexpr bool alt_fails = []
+{
+    string_view in = "c";
+    auto res = alt(unit('a'), unit('b')).parse(in.data(), in.data() + in.size());
+    return res.is_err();
+}();
+static_assert(alt_fails);
+
+int main()
+{
+    // the same grammar at run time
+    string_view in = "GET /a 80\nPOST /b/c 8080\n";
+    auto res = many(route()).parse(in.begin(), in.end());
+
+    return res.is_ok() && res.unwrap_ok().res.size() == 2 ? 0 : 1;
+}
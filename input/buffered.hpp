@@ -0,0 +1,420 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <streambuf>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace apc::input
+{
+    using namespace std;
+
+    namespace buffered_ns
+    {
+        // Reads from an iterator range. Single pass iterators are read one
+        // element at a time, they may wait for elements a parser doesn't need yet
+        template< typename It >
+        class IteratorSource
+        {
+        public:
+
+            using value_type = typename iterator_traits<It>::value_type;
+
+            IteratorSource(It b, It e) : iter(move(b)), end(move(e)) {}
+
+            // At most n elements, 0 at the end
+            size_t read(value_type* out, size_t n)
+            {
+                if constexpr (is_base_of_v<forward_iterator_tag, typename iterator_traits<It>::iterator_category>)
+                {
+                    size_t k = 0;
+                    for (; k < n && iter != end; k++, ++iter)
+                    {
+                        out[k] = *iter;
+                    }
+                    return k;
+                }
+                else
+                {
+                    if (iter == end)
+                    {
+                        return 0;
+                    }
+
+                    *out = *iter;
+                    ++iter;
+                    return 1;
+                }
+            }
+
+        private:
+
+            It iter;
+            It end;
+        };
+
+        // Reads what the stream buffer has and waits only when it has nothing
+        template< typename C, typename Traits >
+        class StreamSource
+        {
+        public:
+
+            using value_type = C;
+
+            StreamSource(basic_streambuf<C, Traits>* buf) : buf(buf) {}
+
+            size_t read(value_type* out, size_t n)
+            {
+                streamsize avail = buf->in_avail();
+                if (avail == 0)
+                {
+                    if (Traits::eq_int_type(buf->sgetc(), Traits::eof()))
+                    {
+                        return 0;
+                    }
+                    avail = max<streamsize>(buf->in_avail(), 1);
+                }
+                else if (avail < 0)
+                {
+                    return 0;
+                }
+
+                return buf->sgetn(out, min<streamsize>(avail, n));
+            }
+
+        private:
+
+            basic_streambuf<C, Traits>* buf;
+        };
+
+        // The elements read from a single pass source that may still be needed.
+        // Positions count the elements read since the start. The ring holds the
+        // last elements read and grows only when the backtrack points of the
+        // running parsers need more of them. The source is only read when a
+        // parser looks past what was read before
+        template< typename Source >
+        class Ring
+        {
+        public:
+
+            using T = typename Source::value_type;
+
+            Ring(Source source, size_t capacity)
+                : source(move(source))
+                , data(round_up(capacity))
+                , mask(data.size() - 1)
+                , filled(0)
+                , exhausted(false)
+                , lowest(size_t(-1)) {}
+
+            T get(size_t pos)
+            {
+                // pos is one of the last mask + 1 elements read
+                if (filled - pos - 1 <= mask)
+                {
+                    return data[pos & mask];
+                }
+
+                return get_slow(pos);
+            }
+
+            bool at_end(size_t pos)
+            {
+                return pos >= filled && !read_to(pos);
+            }
+
+            // Reads the rest of the source
+            size_t length()
+            {
+                while (!exhausted)
+                {
+                    read_to(filled);
+                }
+                return filled;
+            }
+
+            // Returns the lowest point before, which is restored when the point is released
+            size_t push_point(size_t pos)
+            {
+                return exchange(lowest, min(lowest, pos));
+            }
+
+            void pop_point(size_t prev_lowest)
+            {
+                lowest = prev_lowest;
+            }
+
+            size_t capacity() const
+            {
+                return data.size();
+            }
+
+        private:
+
+            Source source;
+
+            vector<T> data;
+            size_t mask;
+            size_t filled;
+            bool exhausted;
+
+            // Position of the lowest active backtrack point. Points are set
+            // and released in nested order, so each one restores the one before
+            size_t lowest;
+
+            static size_t round_up(size_t n)
+            {
+                size_t ret = 16;
+                while (ret < n)
+                {
+                    ret *= 2;
+                }
+                return ret;
+            }
+
+            T get_slow(size_t pos)
+            {
+                if (pos < filled)
+                {
+                    throw logic_error("buffered input: the element was dropped, a parser that goes back needs a backtrack point");
+                }
+
+                if (!read_to(pos))
+                {
+                    throw out_of_range("buffered input: read past the end");
+                }
+
+                return data[pos & mask];
+            }
+
+            // Reads until pos is available, false if the source ends first
+            bool read_to(size_t pos)
+            {
+                while (filled <= pos)
+                {
+                    if (exhausted)
+                    {
+                        return false;
+                    }
+
+                    size_t keep = min(lowest, filled);
+                    if (filled - keep == data.size())
+                    {
+                        grow();
+                    }
+
+                    // up to the first kept element or the end of the ring, whichever comes first
+                    size_t slot = filled & mask;
+                    size_t room = min(data.size() - (filled - keep), data.size() - slot);
+
+                    size_t n = source.read(data.data() + slot, room);
+                    if (n == 0)
+                    {
+                        exhausted = true;
+                        return false;
+                    }
+
+                    filled += n;
+                }
+
+                return true;
+            }
+
+            void grow()
+            {
+                vector<T> bigger(data.size() * 2);
+                size_t bigger_mask = bigger.size() - 1;
+
+                for (size_t pos = filled - min(filled, data.size()); pos < filled; pos++)
+                {
+                    bigger[pos & bigger_mask] = move(data[pos & mask]);
+                }
+
+                data = move(bigger);
+                mask = bigger_mask;
+            }
+        };
+
+        // Releases its backtrack point when it goes out of scope
+        template< typename Source >
+        class BacktrackPoint
+        {
+        public:
+
+            BacktrackPoint(Ring<Source>* ring, size_t pos)
+                : ring(ring)
+                , prev_lowest(ring->push_point(pos)) {}
+
+            BacktrackPoint(const BacktrackPoint&) = delete;
+            BacktrackPoint& operator=(const BacktrackPoint&) = delete;
+
+            ~BacktrackPoint()
+            {
+                ring->pop_point(prev_lowest);
+            }
+
+        private:
+
+            Ring<Source>* ring;
+            size_t prev_lowest;
+        };
+
+        // A position in the ring. Elements are returned by value, the slot
+        // they are read from is reused for later ones
+        template< typename Source >
+        class Iterator
+        {
+        public:
+
+            using iterator_category = forward_iterator_tag;
+            using value_type = typename Ring<Source>::T;
+            using difference_type = ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            static constexpr size_t end_pos = size_t(-1);
+
+            Iterator() : ring(nullptr), pos(end_pos) {}
+
+            Iterator(Ring<Source>* ring, size_t pos) : ring(ring), pos(pos) {}
+
+            value_type operator*() const
+            {
+                return ring->get(pos);
+            }
+
+            Iterator& operator++()
+            {
+                pos++;
+                return *this;
+            }
+
+            Iterator operator++(int)
+            {
+                Iterator ret = *this;
+                pos++;
+                return ret;
+            }
+
+            // The end compares equal to every position the source ends at
+            friend bool operator==(const Iterator& a, const Iterator& b)
+            {
+                if (a.pos == b.pos)
+                {
+                    return true;
+                }
+                else if (a.pos == end_pos)
+                {
+                    return b.ring->at_end(b.pos);
+                }
+                else if (b.pos == end_pos)
+                {
+                    return a.ring->at_end(a.pos);
+                }
+
+                return false;
+            }
+
+            friend bool operator!=(const Iterator& a, const Iterator& b)
+            {
+                return !(a == b);
+            }
+
+            // Found by argument dependent lookup before the ones of std, which
+            // would step through the elements. The distance to the end reads
+            // the rest of the source
+            friend ptrdiff_t distance(const Iterator& a, const Iterator& b)
+            {
+                return ptrdiff_t(b.position() - a.position());
+            }
+
+            friend Iterator next(Iterator iter, ptrdiff_t n = 1)
+            {
+                iter.pos += n;
+                return iter;
+            }
+
+            BacktrackPoint<Source> backtrack_point() const
+            {
+                return BacktrackPoint<Source>(ring, pos);
+            }
+
+            // Elements read from the start of the source up to here
+            size_t position() const
+            {
+                return pos == end_pos ? ring->length() : pos;
+            }
+
+        private:
+
+            Ring<Source>* ring;
+            size_t pos;
+        };
+
+        // A single pass range of elements, such as istreambuf_iterators, made
+        // into forward iterators that can go back to positions held by
+        // backtrack points. It owns the ring and must outlive its iterators
+        template< typename Source >
+        class Buffered
+        {
+        public:
+
+            using iterator = Iterator<Source>;
+            using const_iterator = Iterator<Source>;
+            using value_type = typename Ring<Source>::T;
+
+            Buffered(Source source, size_t capacity)
+                : ring(make_unique<Ring<Source>>(move(source), capacity)) {}
+
+            iterator begin() const
+            {
+                return iterator(ring.get(), 0);
+            }
+
+            iterator end() const
+            {
+                return iterator(ring.get(), iterator::end_pos);
+            }
+
+            // Elements the ring holds now, it grows when backtrack points need more
+            size_t capacity() const
+            {
+                return ring->capacity();
+            }
+
+        private:
+
+            unique_ptr<Ring<Source>> ring;
+        };
+    }
+
+    using buffered_ns::Buffered;
+
+    // Parses straight from a single pass source, for example
+    //     auto in = input::buffered(cin);
+    //     many(record).for_each(f).parse(in.begin(), in.end());
+    // Memory stays at the capacity as long as every record fits. Parsers that
+    // need contiguous input (raw, span_of) or addresses of elements (memo) don't
+    // work on it, and neither does rebuilding a fast fail error afterwards
+    template< typename It >
+    auto buffered(It b, It e, size_t capacity = 4096)
+    {
+        using Source = buffered_ns::IteratorSource<It>;
+        return Buffered<Source>(Source(move(b), move(e)), capacity);
+    }
+
+    // Reads from the stream buffer in blocks of what has arrived, which is
+    // faster than istreambuf_iterators and still never waits for more
+    template< typename C, typename Traits >
+    auto buffered(basic_istream<C, Traits>& stream, size_t capacity = 4096)
+    {
+        using Source = buffered_ns::StreamSource<C, Traits>;
+        return Buffered<Source>(Source(stream.rdbuf()), capacity);
+    }
+}
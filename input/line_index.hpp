@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "../res.hpp"
+#include "../simd.hpp"
+
+namespace apc::input
+{
+    using namespace std;
+
+    // The lines of a text, for showing where an error is. Nothing is done until
+    // the first lookup, which finds every newline in one pass and keeps where every
+    // lines_per_sample-th line starts. Later lookups are a binary search over those
+    // and a SIMD scan of less than lines_per_sample lines. A parse that succeeds
+    // never pays for it. The text must outlive the index
+    class LineIndex
+    {
+    public:
+
+        // Both count from 1, columns in bytes
+        struct Location
+        {
+            size_t line;
+            size_t column;
+        };
+
+        // 8 bytes of index per 64 lines
+        static constexpr size_t lines_per_sample = 64;
+
+        LineIndex(const char* b, const char* e) : b(b), e(e) {}
+
+        // Any contiguous text, such as a string or a MappedFile
+        template< typename Text >
+        explicit LineIndex(const Text& text) : LineIndex(data(text), data(text) + size(text)) {}
+
+        LineIndex(const LineIndex&) = delete;
+        LineIndex& operator=(const LineIndex&) = delete;
+
+        // offset from the start of the text, offsets past its end are located at the end
+        Location locate(size_t offset) const
+        {
+            offset = min(offset, size_t(e - b));
+
+            const vector<size_t>& starts = sampled_starts();
+
+            // the last sampled line that starts at or before offset
+            size_t sample = size_t(upper_bound(starts.begin(), starts.end(), offset) - starts.begin()) - 1;
+            size_t line = sample * lines_per_sample;
+            size_t scan_start = starts[sample];
+            size_t line_start = scan_start;
+
+            // a newline ends its line
+            simd::find_each(b + scan_start, offset - scan_start, '\n', [&](size_t i)
+            {
+                line++;
+                line_start = scan_start + i + 1;
+            });
+
+            return { line + 1, offset - line_start + 1 };
+        }
+
+        Location locate(const char* pos) const
+        {
+            return locate(size_t(pos - b));
+        }
+
+        // For res::print_trace, with parse_begin where the traced parse started
+        res::TracePositions positions(const char* parse_begin) const
+        {
+            res::TracePositions ret;
+            ret.base = size_t(parse_begin - b);
+            ret.arg = this;
+            ret.print = [](ostream& out, size_t offset, const void* arg)
+            {
+                Location loc = static_cast<const LineIndex*>(arg)->locate(offset);
+                out << loc.line << ':' << loc.column;
+            };
+            return ret;
+        }
+
+    private:
+
+        const char* b;
+        const char* e;
+
+        mutable once_flag built;
+
+        // where lines 0, lines_per_sample, 2 * lines_per_sample... start, counted from 0
+        mutable vector<size_t> starts;
+
+        const vector<size_t>& sampled_starts() const
+        {
+            call_once(built, [this]
+            {
+                starts.push_back(0);
+
+                size_t n = 0;
+                simd::find_each(b, size_t(e - b), '\n', [this, &n](size_t i)
+                {
+                    if (++n % lines_per_sample == 0)
+                    {
+                        starts.push_back(i + 1);
+                    }
+                });
+            });
+            return starts;
+        }
+    };
+
+    // Prints the trace of err with lines and columns of the text instead of
+    // offsets, parse_begin is where the parse that failed started
+    template< typename E >
+    void print_trace(E& err, const LineIndex& index, const char* parse_begin, ostream& out = cerr)
+    {
+        res::print_trace(err, out, 0, true, index.positions(parse_begin));
+    }
+}
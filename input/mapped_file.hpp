@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace apc::input
+{
+    using namespace std;
+
+    // A file mapped into memory read-only. Its iterators are plain pointers,
+    // so parsers get the same fast paths as with a string.
+    // The pages are read in by the kernel on first access, so files larger
+    // than RAM work and nothing is copied before parsing starts
+    struct MappedFile
+    {
+        using iterator = const char*;
+        using const_iterator = const char*;
+        using value_type = char;
+
+        MappedFile() : _data(nullptr), _size(0) {}
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) noexcept
+            : _data(exchange(other._data, nullptr))
+            , _size(exchange(other._size, 0)) {}
+
+        MappedFile& operator=(MappedFile&& other) noexcept
+        {
+            if (this != &other)
+            {
+                unmap();
+                _data = exchange(other._data, nullptr);
+                _size = exchange(other._size, 0);
+            }
+
+            return *this;
+        }
+
+        ~MappedFile()
+        {
+            unmap();
+        }
+
+        const char* begin() const
+        {
+            return _data;
+        }
+
+        const char* end() const
+        {
+            return _data + _size;
+        }
+
+        const char* data() const
+        {
+            return _data;
+        }
+
+        size_t size() const
+        {
+            return _size;
+        }
+
+        bool empty() const
+        {
+            return _size == 0;
+        }
+
+        string_view view() const
+        {
+            return string_view(_data, _size);
+        }
+
+    private:
+
+        const char* _data;
+        size_t _size;
+
+        MappedFile(const char* data, size_t size) : _data(data), _size(size) {}
+
+        friend MappedFile mapped_file(const string& path, error_code& ec);
+
+        void unmap()
+        {
+            if (_data != nullptr)
+            {
+                munmap(const_cast<char*>(_data), _size);
+                _data = nullptr;
+                _size = 0;
+            }
+        }
+    };
+
+    // Maps the file at path. On failure sets ec and returns an empty file.
+    // An empty file maps to an empty range without calling mmap. Anything but
+    // a regular file whose size is known up front fails with invalid_argument
+    inline MappedFile mapped_file(const string& path, error_code& ec)
+    {
+        ec.clear();
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            ec = error_code(errno, system_category());
+            return MappedFile();
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            ec = error_code(errno, system_category());
+            close(fd);
+            return MappedFile();
+        }
+
+        // the size of anything else (pipes, devices, /proc entries) is not
+        // the size of its contents, and most of them can't be mapped
+        if (!S_ISREG(st.st_mode))
+        {
+            ec = make_error_code(errc::invalid_argument);
+            close(fd);
+            return MappedFile();
+        }
+
+        if (static_cast<uintmax_t>(st.st_size) > SIZE_MAX)
+        {
+            ec = make_error_code(errc::file_too_large);
+            close(fd);
+            return MappedFile();
+        }
+
+        size_t size = static_cast<size_t>(st.st_size);
+        if (size == 0)
+        {
+            // files made up on reading, such as /proc entries, say they are empty
+            char c;
+            if (::read(fd, &c, 1) != 0)
+            {
+                ec = make_error_code(errc::invalid_argument);
+            }
+
+            close(fd);
+            return MappedFile();
+        }
+
+        void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        int mmap_errno = errno;
+
+        // the mapping keeps the file open on its own
+        close(fd);
+
+        if (addr == MAP_FAILED)
+        {
+            ec = error_code(mmap_errno, system_category());
+            return MappedFile();
+        }
+
+        // parsers read front to back, so aggressive read-ahead pays off
+        // and pages behind the parse can be dropped early
+        madvise(addr, size, MADV_SEQUENTIAL);
+
+        return MappedFile(static_cast<const char*>(addr), size);
+    }
+}
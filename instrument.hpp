@@ -0,0 +1,429 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "misc.hpp"
+
+// Opt-in accounting of what every parser does. With APC_INSTRUMENT defined
+// every parse and recognize reports its calls, the bytes it consumed, the
+// allocations it made and the copies and moves of Ok and Err values to a
+// registry of the thread, keyed by the kind of parser and the label of the
+// innermost named parser around it. Without it the probes compile to nothing.
+//
+// Allocations are only seen when the global allocation functions report them.
+// Defining APC_INSTRUMENT_NEW in exactly one translation unit before including
+// the library replaces them with ones that do
+
+namespace apc::instrument
+{
+    using namespace std;
+
+    struct Totals
+    {
+        size_t allocations = 0;
+        size_t ok_copies = 0;
+        size_t ok_moves = 0;
+        size_t err_copies = 0;
+        size_t err_moves = 0;
+
+        Totals& operator+=(const Totals& other)
+        {
+            allocations += other.allocations;
+            ok_copies += other.ok_copies;
+            ok_moves += other.ok_moves;
+            err_copies += other.err_copies;
+            err_moves += other.err_moves;
+            return *this;
+        }
+
+        Totals operator-(const Totals& other) const
+        {
+            Totals ret;
+            ret.allocations = allocations - other.allocations;
+            ret.ok_copies = ok_copies - other.ok_copies;
+            ret.ok_moves = ok_moves - other.ok_moves;
+            ret.err_copies = err_copies - other.err_copies;
+            ret.err_moves = err_moves - other.err_moves;
+            return ret;
+        }
+    };
+
+    struct Counters
+    {
+        size_t calls = 0;
+        size_t oks = 0;
+        size_t errs = 0;
+        size_t eois = 0;
+
+        // consumed by successful calls
+        size_t bytes = 0;
+
+        // done by the parser itself and by it together with the parsers inside it
+        Totals self;
+        Totals total;
+
+        Counters& operator+=(const Counters& other)
+        {
+            calls += other.calls;
+            oks += other.oks;
+            errs += other.errs;
+            eois += other.eois;
+            bytes += other.bytes;
+            self += other.self;
+            total += other.total;
+            return *this;
+        }
+    };
+
+    // kind of parser and label, both string literals or strings that outlive the registry
+    using Key = pair<const char*, const char*>;
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return hash<const void*>()(key.first) * 31 + hash<const void*>()(key.second);
+        }
+    };
+
+    using Registry = unordered_map<Key, Counters, KeyHash>;
+
+    // Registries of the threads that are running and of the ones that exited
+    struct Global
+    {
+        mutex m;
+        vector<Registry*> live;
+        Registry retired;
+    };
+
+    inline Global& global()
+    {
+        static Global g;
+        return g;
+    }
+
+    // Counters of the current thread. Allocations and copies are counted
+    // in `now` and probes attribute the differences to their parser
+    struct Thread
+    {
+        Totals now;
+
+        // totals of the parsers called by the innermost running probe
+        Totals* children = nullptr;
+
+        const char* label = "";
+
+        Registry registry;
+
+        Thread()
+        {
+            lock_guard lock(global().m);
+            global().live.push_back(&registry);
+        }
+
+        ~Thread()
+        {
+            lock_guard lock(global().m);
+            auto& live = global().live;
+            live.erase(find(live.begin(), live.end(), &registry));
+
+            for (auto& [key, counters] : registry)
+            {
+                global().retired[key] += counters;
+            }
+        }
+    };
+
+    inline Thread& thread()
+    {
+        thread_local Thread t;
+        return t;
+    }
+
+    // Trivially destructible so the allocation functions can use it at any time
+    inline thread_local size_t allocations = 0;
+
+    inline void count_allocation()
+    {
+        allocations++;
+    }
+
+#if defined(APC_INSTRUMENT)
+    inline constexpr bool enabled = true;
+#else
+    inline constexpr bool enabled = false;
+#endif
+
+    inline void count_ok_copy()
+    {
+        if constexpr (enabled)
+        {
+            thread().now.ok_copies++;
+        }
+    }
+
+    inline void count_ok_move()
+    {
+        if constexpr (enabled)
+        {
+            thread().now.ok_moves++;
+        }
+    }
+
+    inline void count_err_copy()
+    {
+        if constexpr (enabled)
+        {
+            thread().now.err_copies++;
+        }
+    }
+
+    inline void count_err_move()
+    {
+        if constexpr (enabled)
+        {
+            thread().now.err_moves++;
+        }
+    }
+
+    // Sets a variable for its lifetime and restores the previous value afterwards,
+    // also when a parser throws
+    template< typename T >
+    struct Restore
+    {
+        T& var;
+        T prev;
+
+        Restore(T& var, T value) : var(var), prev(exchange(var, move(value))) {}
+
+        Restore(const Restore&) = delete;
+        Restore& operator=(const Restore&) = delete;
+
+        ~Restore()
+        {
+            var = move(prev);
+        }
+    };
+
+    // Runs f, the body of a parse or recognize of a parser of the given kind
+    // starting at b, and records what it did
+    template< typename I, typename F >
+    constexpr auto probe(const char* kind, I b, F&& f)
+    {
+        if constexpr (!enabled)
+        {
+            return f();
+        }
+        else
+        {
+            if (misc::is_constant_evaluated())
+            {
+                return f();
+            }
+
+            Thread& t = thread();
+
+            t.now.allocations = allocations;
+            Totals start = t.now;
+
+            Totals children;
+            Totals* parent = t.children;
+
+            Restore<Totals*> scope(t.children, &children);
+            auto res = f();
+
+            t.now.allocations = allocations;
+            Totals total = t.now - start;
+
+            if (parent != nullptr)
+            {
+                *parent += total;
+            }
+
+            // the first call of a kind adds it to the registry, which is not the parser's doing
+            size_t before = allocations;
+            Counters& c = t.registry[{ kind, t.label }];
+            allocations = before;
+
+            c.calls++;
+            c.total += total;
+            c.self += total - children;
+
+            if (res.is_ok())
+            {
+                c.oks++;
+                c.bytes += distance(b, res.unwrap_ok().pos);
+            }
+            else if (res.is_err())
+            {
+                c.errs++;
+            }
+            else
+            {
+                c.eois++;
+            }
+
+            return res;
+        }
+    }
+
+    // Sets the label of the probes run inside f
+    template< typename F >
+    constexpr auto with_label(const char* label, F&& f)
+    {
+        if constexpr (!enabled)
+        {
+            return f();
+        }
+        else
+        {
+            if (misc::is_constant_evaluated())
+            {
+                return f();
+            }
+
+            Restore<const char*> scope(thread().label, label);
+            return f();
+        }
+    }
+
+    // Counters of all threads merged by kind and label. Threads that are still
+    // parsing while this runs may be counted partly
+    inline vector<pair<pair<string, string>, Counters>> collect()
+    {
+        vector<pair<pair<string, string>, Counters>> ret;
+
+        auto add = [&](const Registry& registry)
+        {
+            for (auto& [key, counters] : registry)
+            {
+                pair<string, string> name{ key.first, key.second };
+                auto iter = find_if(ret.begin(), ret.end(), [&](auto& entry) { return entry.first == name; });
+
+                if (iter == ret.end())
+                {
+                    ret.emplace_back(name, counters);
+                }
+                else
+                {
+                    iter->second += counters;
+                }
+            }
+        };
+
+        lock_guard lock(global().m);
+        add(global().retired);
+        for (Registry* registry : global().live)
+        {
+            add(*registry);
+        }
+
+        return ret;
+    }
+
+    // Forgets everything counted so far. No thread may be parsing meanwhile
+    inline void reset()
+    {
+        lock_guard lock(global().m);
+        global().retired.clear();
+        for (Registry* registry : global().live)
+        {
+            registry->clear();
+        }
+    }
+
+    // Prints a table of the counters, the parsers that allocate the most on their own first
+    inline void report(ostream& out)
+    {
+        auto entries = collect();
+        sort(entries.begin(), entries.end(), [](auto& a, auto& b)
+        {
+            return a.second.self.allocations != b.second.self.allocations
+                ? a.second.self.allocations > b.second.self.allocations
+                : a.second.calls > b.second.calls;
+        });
+
+        char line[256];
+        snprintf(line, sizeof(line), "%-14s %-20s %10s %10s %10s %10s %10s %12s %12s\n",
+                 "parser", "label", "calls", "fails", "bytes", "allocs", "allocs all",
+                 "ok cp/mv", "err cp/mv");
+        out << line;
+
+        for (auto& [name, c] : entries)
+        {
+            string ok = to_string(c.self.ok_copies) + "/" + to_string(c.self.ok_moves);
+            string err = to_string(c.self.err_copies) + "/" + to_string(c.self.err_moves);
+
+            snprintf(line, sizeof(line), "%-14s %-20s %10zu %10zu %10zu %10zu %10zu %12s %12s\n",
+                     name.first.c_str(), name.second.c_str(),
+                     c.calls, c.errs + c.eois, c.bytes,
+                     c.self.allocations, c.total.allocations,
+                     ok.c_str(), err.c_str());
+            out << line;
+        }
+    }
+}
+
+#if defined(APC_INSTRUMENT_NEW)
+
+namespace apc::instrument
+{
+    // Both new operators call it, so each is paired with free where it is
+    // inlined
+    inline void* allocate(size_t size)
+    {
+        count_allocation();
+
+        if (void* p = malloc(size == 0 ? 1 : size))
+        {
+            return p;
+        }
+
+        throw bad_alloc();
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    return apc::instrument::allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return apc::instrument::allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif
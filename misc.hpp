@@ -6,6 +6,11 @@
 #include <utility>
 #include <optional>
 #include <variant>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <experimental/type_traits>
 
 namespace apc::misc
@@ -161,7 +166,101 @@ namespace apc::misc
 
 
     template< typename I >
-    size_t calc_inner_offset(I b, I err_pos)
+    using value_type_t = typename iterator_traits<I>::value_type;
+
+    template< typename T >
+    using data_t = decltype(data(declval<const T&>()));
+
+    template< typename T >
+    using size_t_t = decltype(size(declval<const T&>()));
+
+    // Iterators of std containers that are known to store their elements contiguously
+    template< typename I >
+    constexpr bool is_contiguous_iterator()
+    {
+        if constexpr (is_pointer_v<I>)
+        {
+            return true;
+        }
+        else if constexpr (!is_detected_v<value_type_t, I>)
+        {
+            return false;
+        }
+        else
+        {
+            using V = value_type_t<I>;
+
+            if constexpr (is_same_v<V, bool> || !is_object_v<V>)
+            {
+                return false;
+            }
+            else if constexpr (is_same_v<V, char> || is_same_v<V, wchar_t> ||
+                               is_same_v<V, char16_t> || is_same_v<V, char32_t>)
+            {
+                return is_same_v<I, typename basic_string<V>::iterator> ||
+                       is_same_v<I, typename basic_string<V>::const_iterator> ||
+                       is_same_v<I, typename basic_string_view<V>::const_iterator> ||
+                       is_same_v<I, typename vector<V>::iterator> ||
+                       is_same_v<I, typename vector<V>::const_iterator>;
+            }
+            else
+            {
+                return is_same_v<I, typename vector<V>::iterator> ||
+                       is_same_v<I, typename vector<V>::const_iterator>;
+            }
+        }
+    }
+
+    template< typename I >
+    constexpr bool is_contiguous_iterator_v = is_contiguous_iterator<I>();
+
+    // True while the compiler evaluates a constant expression. Paths that use
+    // SIMD, thread locals or the heap check it and fall back to plain code.
+    // The builtin is there in C++17 already
+    constexpr bool is_constant_evaluated() noexcept
+    {
+        return __builtin_is_constant_evaluated();
+    }
+
+    // Element types that can be handled as raw bytes
+    template< typename T >
+    constexpr bool is_byte_v = is_integral_v<T> && sizeof(T) == 1;
+
+    // Containers that expose their elements through data() and size()
+    template< typename T >
+    constexpr bool is_contiguous_v = is_detected_v<data_t, T> && is_detected_v<size_t_t, T>;
+
+    // Must only be called on a dereferenceable iterator
+    template< typename I >
+    constexpr auto to_pointer(I iter)
+    {
+        return addressof(*iter);
+    }
+
+
+    template< typename I >
+    using backtrack_point_t = decltype(declval<const I&>().backtrack_point());
+
+    struct NoBacktrackPoint {};
+
+    // Held by parsers that may go back to pos after reading past it. Inputs that
+    // forget what was read keep everything from pos on while it lives
+    template< typename I >
+    constexpr auto backtrack_point(const I& pos)
+    {
+        if constexpr (is_detected_v<backtrack_point_t, I>)
+        {
+            return pos.backtrack_point();
+        }
+        else
+        {
+            return NoBacktrackPoint{};
+        }
+    }
+
+
+    template< typename I >
+    constexpr size_t calc_inner_offset(I b, I err_pos)
     {
         return distance(b, err_pos);
     }
@@ -179,6 +278,12 @@ namespace apc::misc
         return true;
     }
 
+    template< typename T >
+    constexpr bool is_optional_v = false;
+
+    template< typename T >
+    constexpr bool is_optional_v<optional<T>> = true;
+
     template< typename T >
     constexpr bool is_variant(const T&)
     {
@@ -190,4 +295,10 @@ namespace apc::misc
     {
         return true;
     }
+
+    template< typename T >
+    constexpr bool is_variant_v = false;
+
+    template< typename... Ts >
+    constexpr bool is_variant_v<variant<Ts...>> = true;
 }
@@ -4,8 +4,16 @@
 #include <optional>
 #include <variant>
 #include <tuple>
+#include <array>
+#include <bitset>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 
-namespace apc
+#include "first_set.hpp"
+#include "recognize.hpp"
+
+namespace apc::parsers
 {
     namespace alt_ns
     {
@@ -20,7 +28,7 @@ namespace apc
             size_t n_err;
             size_t n_eoi;
 
-            AltErr(size_t n_err, size_t n_eoi)
+            constexpr AltErr(size_t n_err, size_t n_eoi)
                 : prev()
                 , n_err(n_err)
                 , n_eoi(n_eoi) {}
@@ -37,46 +45,125 @@ namespace apc
                 {
                     stringstream sstream;
                     sstream << "Alt error because "
-                            << n_err << (n_err == 1 ? "alternative" : "alternatives") << "failed and "
-                            << n_eoi << (n_eoi == 1 ? "alternative" : "alternatives") << "met end of input";
+                            << n_err << (n_err == 1 ? " alternative" : " alternatives") << " failed and "
+                            << n_eoi << (n_eoi == 1 ? " alternative" : " alternatives") << " met end of input";
 
                     return { sstream.str(), 0 };
                 }
             }
         };
 
-        template< typename I, typename Ok_T, typename P, typename... Ps >
-        auto alt_impl(size_t n_err, size_t n_eoi, I b, I e, P& head, Ps&... tail) -> variant<res::Ok<Ok_T, I>, tuple<size_t, size_t>>
+        // Tries alternative number n and returns true if it succeeded.
+        // When Ok_T is NilOk the alternative is only recognized and its value is not built
+        template< size_t n, typename Ok_T, typename I, typename... Ps >
+        constexpr bool alt_try(tuple<Ps...>& parsers, optional<res::Ok<Ok_T, I>>& out, size_t& n_err, size_t& n_eoi, I b, I e)
         {
-            auto head_res = head.parse(b, e);
-            if (head_res.is_ok())
+            auto& parser = get<n>(parsers);
+
+            auto res = [&]
             {
-                auto res_ok = move(head_res.unwrap_ok());
+                if constexpr (is_same_v<Ok_T, NilOk>)
+                {
+                    return parsers::recognize(parser, b, e);
+                }
+                else
+                {
+                    return parser.parse(b, e);
+                }
+            }();
 
-                return ok(Ok_T(res_ok.res), res_ok.pos);
-            }
-            else if (head_res.is_err())
+            if (res.is_ok())
             {
-                if constexpr (sizeof...(Ps) == 0)
+                auto res_ok = move(res.unwrap_ok());
+
+                if constexpr (is_same_v<Ok_T, NilOk>)
                 {
-                    return make_tuple(n_err, n_eoi);
+                    out.emplace(NilOk{}, res_ok.pos);
                 }
                 else
                 {
-                    return alt_impl<I, Ok_T>(n_err+1, n_eoi, b, e, tail...);
+                    out.emplace(Ok_T(move(res_ok.res)), res_ok.pos);
                 }
+
+                return true;
+            }
+            else if (res.is_err())
+            {
+                n_err++;
             }
             else
             {
-                if constexpr (sizeof...(Ps) == 0)
+                n_eoi++;
+            }
+
+            return false;
+        }
+
+        // Runs the candidate alternatives in order until one succeeds.
+        // Alternatives that are not candidates are known to fail on the first element
+        // and are counted as errors without running them
+        template< typename I, typename Ok_T, typename Candidates, typename... Ps, size_t... Is >
+        auto alt_impl(const Candidates& candidates, I b, I e, tuple<Ps...>& parsers, index_sequence<Is...>)
+            -> variant<res::Ok<Ok_T, I>, tuple<size_t, size_t>>
+        {
+            using Try = bool (*)(tuple<Ps...>&, optional<res::Ok<Ok_T, I>>&, size_t&, size_t&, I, I);
+            static constexpr Try tries[] = { &alt_try<Is, Ok_T, I, Ps...>... };
+
+            optional<res::Ok<Ok_T, I>> res_ok;
+            size_t n_err = sizeof...(Ps) - candidates.count();
+            size_t n_eoi = 0;
+
+            if constexpr (sizeof...(Ps) <= 64)
+            {
+                for (uint64_t mask = candidates.to_ullong(); mask != 0; mask &= mask - 1)
                 {
-                    return make_tuple(n_err, n_eoi);
+                    if (tries[__builtin_ctzll(mask)](parsers, res_ok, n_err, n_eoi, b, e))
+                    {
+                        return move(*res_ok);
+                    }
+
+                    // with partial input an earlier alternative that ran out of input could still win
+                    if (n_eoi != 0 && partial_input())
+                    {
+                        break;
+                    }
                 }
-                else
+            }
+            else
+            {
+                for (size_t n = 0; n < sizeof...(Ps); n++)
                 {
-                    return alt_impl<I, Ok_T>(n_err, n_eoi+1, b, e, tail...);
+                    if (candidates[n] && tries[n](parsers, res_ok, n_err, n_eoi, b, e))
+                    {
+                        return move(*res_ok);
+                    }
+
+                    if (n_eoi != 0 && partial_input())
+                    {
+                        break;
+                    }
                 }
             }
+
+            return make_tuple(n_err, n_eoi);
+        }
+
+        // Runs every alternative in order until one succeeds. Used in constant
+        // evaluation, where the dispatch table and its function pointers are not available
+        template< typename I, typename Ok_T, typename... Ps, size_t... Is >
+        constexpr auto alt_all(I b, I e, tuple<Ps...>& parsers, index_sequence<Is...>)
+            -> variant<res::Ok<Ok_T, I>, tuple<size_t, size_t>>
+        {
+            optional<res::Ok<Ok_T, I>> res_ok;
+            size_t n_err = 0;
+            size_t n_eoi = 0;
+
+            if ((alt_try<Is, Ok_T, I, Ps...>(parsers, res_ok, n_err, n_eoi, b, e) || ...))
+            {
+                return move(*res_ok);
+            }
+
+            return make_tuple(n_err, n_eoi);
         }
 
         template< typename... Ps >
@@ -94,25 +181,216 @@ namespace apc
 
             using Err = AltErr;
 
-            Alt(Ps... parsers) : parsers(make_tuple(move(parsers)...)) {}
+            // Bit i is set if alternative i has to be tried
+            using Candidates = bitset<sizeof...(Ps)>;
+
+        private:
+
+            struct Dispatch
+            {
+                // Candidates for every possible first byte of the input
+                array<Candidates, 256> table;
+
+                // number of Alts sharing the table
+                atomic<size_t> refs;
+
+                Dispatch() : table(), refs(1) {}
+
+                void add_alternative(size_t n, const first_set_ns::FirstSet& set)
+                {
+                    for (size_t c = 0; c < 256; c++)
+                    {
+                        if (!set.has_value() || (*set)[c])
+                        {
+                            table[c].set(n);
+                        }
+                    }
+                }
+            };
+
+            // Stands for "none of the alternatives knows its first set", so the
+            // search for a table is not repeated
+            static inline Dispatch no_table;
+
+            // The table, built by the first parse that needs it. Reference counted
+            // like shared_ptr, copies made after that share it. Empty in constant
+            // evaluation, where the table is never built
+            class DispatchRef
+            {
+            public:
+
+                constexpr DispatchRef() : ptr(nullptr) {}
+
+                constexpr DispatchRef(const DispatchRef& other) : ptr(nullptr)
+                {
+                    if (!misc::is_constant_evaluated())
+                    {
+                        Dispatch* p = other.ptr.load(memory_order_acquire);
+                        if (p != nullptr && p != &no_table)
+                        {
+                            p->refs.fetch_add(1, memory_order_relaxed);
+                        }
+                        ptr.store(p, memory_order_relaxed);
+                    }
+                }
+
+                constexpr DispatchRef(DispatchRef&& other) noexcept : ptr(nullptr)
+                {
+                    if (!misc::is_constant_evaluated())
+                    {
+                        ptr.store(other.ptr.exchange(nullptr, memory_order_acq_rel), memory_order_relaxed);
+                    }
+                }
+
+                constexpr DispatchRef& operator=(DispatchRef other) noexcept
+                {
+                    if (!misc::is_constant_evaluated())
+                    {
+                        Dispatch* mine = ptr.load(memory_order_relaxed);
+                        ptr.store(other.ptr.load(memory_order_relaxed), memory_order_relaxed);
+                        other.ptr.store(mine, memory_order_relaxed);
+                    }
+                    return *this;
+                }
+
+#if __cpp_constexpr >= 201907L
+                constexpr
+#endif
+                ~DispatchRef()
+                {
+                    if (!misc::is_constant_evaluated())
+                    {
+                        Dispatch* p = ptr.load(memory_order_acquire);
+                        if (p != nullptr && p != &no_table && p->refs.fetch_sub(1, memory_order_acq_rel) == 1)
+                        {
+                            delete p;
+                        }
+                    }
+                }
+
+                // Threads that parse with the same Alt may both build a table, one of them is kept
+                template< typename F >
+                const Dispatch* get(F build) const
+                {
+                    Dispatch* p = ptr.load(memory_order_acquire);
+                    if (p == nullptr)
+                    {
+                        Dispatch* built = build();
+                        if (ptr.compare_exchange_strong(p, built, memory_order_acq_rel, memory_order_acquire))
+                        {
+                            p = built;
+                        }
+                        else if (built != &no_table)
+                        {
+                            delete built;
+                        }
+                    }
+                    return p;
+                }
+
+            private:
+
+                mutable atomic<Dispatch*> ptr;
+            };
+
+            // Two alternatives are tried faster than the table is looked up
+            static constexpr bool uses_dispatch = sizeof...(Ps) >= 3;
+
+            DispatchRef dispatch;
+
+        public:
+
+            constexpr Alt(Ps... parsers) : parsers(make_tuple(move(parsers)...)) {}
+
+            first_set_ns::FirstSet first_set() const
+            {
+                return apply([](const auto&... parsers)
+                {
+                    first_set_ns::FirstSet set = bitset<256>();
+                    ((set = first_set_ns::merge(set, apc::parsers::first_set(parsers))), ...);
+                    return set;
+                }, parsers);
+            }
+
+            template< typename I >
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("alt", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return parse_impl<Ok>(b, e);
+                });
+            }
 
             template< typename I >
-            Result<Ok, Err, I> parse(I b, I e)
+            constexpr Result<NilOk, Err, I> recognize(I b, I e)
             {
-                auto res = apply([&b, &e](auto&... parsers)
+                return instrument::probe("alt", b, [&]() -> Result<NilOk, Err, I>
                 {
-                    return alt_impl<I, Ok>(0, 0, b, e, parsers...);
+                    return parse_impl<NilOk>(b, e);
+                });
+            }
+
+        private:
+
+            // The first sets of rules are read here, so a rule must be defined
+            // before the first parse and is not looked at again
+            Dispatch* build_dispatch() const
+            {
+                auto sets = apply([](const auto&... parsers)
+                {
+                    return array<first_set_ns::FirstSet, sizeof...(Ps)>{ apc::parsers::first_set(parsers)... };
                 }, parsers);
 
-                if (holds_alternative<res::Ok<Ok, I>>(res))
+                auto has_first_set = [](const auto& set) { return set.has_value(); };
+                if (none_of(sets.begin(), sets.end(), has_first_set))
+                {
+                    return &no_table;
+                }
+
+                auto* new_dispatch = new Dispatch();
+                for (size_t n = 0; n < sets.size(); n++)
+                {
+                    new_dispatch->add_alternative(n, sets[n]);
+                }
+                return new_dispatch;
+            }
+
+            template< typename I >
+            Candidates candidates(I b, I e) const
+            {
+                if constexpr (uses_dispatch && misc::is_byte_v<remove_cv_t<misc::value_type_t<I>>>)
+                {
+                    if (b != e)
+                    {
+                        const Dispatch* table = dispatch.get([this] { return build_dispatch(); });
+                        if (table != &no_table)
+                        {
+                            return table->table[static_cast<unsigned char>(*b)];
+                        }
+                    }
+                }
+
+                return Candidates().set();
+            }
+
+            template< typename O, typename I >
+            constexpr Result<O, Err, I> parse_impl(I b, I e)
+            {
+                [[maybe_unused]] auto point = misc::backtrack_point(b);
+
+                auto res = misc::is_constant_evaluated()
+                    ? alt_all<I, O>(b, e, parsers, index_sequence_for<Ps...>())
+                    : alt_impl<I, O>(candidates(b, e), b, e, parsers, index_sequence_for<Ps...>());
+
+                if (holds_alternative<res::Ok<O, I>>(res))
                 {
-                    return get<res::Ok<Ok, I>>(move(res));
+                    return get<res::Ok<O, I>>(move(res));
                 }
                 else
                 {
                     auto [ n_err, n_eoi ] = get<tuple<size_t, size_t>>(move(res));
 
-                    if (n_err != 0)
+                    if (n_err != 0 && !(n_eoi != 0 && partial_input()))
                     {
                         return err(AltErr(n_err, n_eoi), b);
                     }
@@ -126,7 +404,7 @@ namespace apc
     }
 
     template< typename... Ps >
-    auto alt(Ps... parsers)
+    constexpr auto alt(Ps... parsers)
     {
         static_assert(sizeof...(Ps) > 0, "alt parser requires at least one argument");
         return alt_ns::Alt<Ps...>(move(parsers)...);
@@ -12,23 +12,26 @@ namespace apc::parsers
             using Ok = T;
             using Err = NilErr;
 
-            Any() {}
+            constexpr Any() {}
 
             template< typename I >
-            Result<Ok, Err, I> parse(I b, I e)
+            constexpr Result<Ok, Err, I> parse(I b, I e)
             {
-                if (b >= e)
+                return instrument::probe("any", b, [&]() -> Result<Ok, Err, I>
                 {
-                    return EOI("Any");
-                }
+                    if (b == e)
+                    {
+                        return EOI("Any");
+                    }
 
-                return ok(*b, next(b));
+                    return ok(*b, next(b));
+                });
             }
         };
     }
 
     template< typename T >
-    any_ns::Any<T> any()
+    constexpr any_ns::Any<T> any()
     {
         return any_ns::Any<T>();
     }
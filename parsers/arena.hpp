@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+#include "../res.hpp"
+
+namespace apc::parsers
+{
+    namespace arena_ns
+    {
+        using namespace res;
+
+        // Monotonic memory for the results of parses. Allocating is a pointer bump,
+        // freeing does nothing and release() drops everything at once.
+        // The first block is reused after every release, so an arena kept per
+        // thread doesn't touch the global heap once it has grown large enough
+        class Arena
+        {
+        public:
+
+            Arena(size_t initial_size = 64 * 1024)
+                : buffer(new std::byte[initial_size])
+                , monotonic(buffer.get(), initial_size, pmr::new_delete_resource()) {}
+
+            Arena(const Arena&) = delete;
+            Arena& operator=(const Arena&) = delete;
+
+            pmr::memory_resource* resource()
+            {
+                return &monotonic;
+            }
+
+            // Everything allocated from the arena is invalid afterwards
+            void release()
+            {
+                monotonic.release();
+            }
+
+        private:
+
+            unique_ptr<std::byte[]> buffer;
+            pmr::monotonic_buffer_resource monotonic;
+        };
+    }
+
+    using arena_ns::Arena;
+
+    // Runs the parser with the arena as the memory resource of the parse context.
+    // Containers with polymorphic allocators in the result (many_pmr, many_into<pmr::...>)
+    // live in the arena and stay valid until it is released. Memos keep their
+    // results only for this call, so none of them outlives the arena
+    template< typename P, typename I >
+    auto parse_in(Arena& arena, P& parser, I b, I e)
+    {
+        res::ResourceScope scope(arena.resource());
+        res::ParseScope parse;
+        return parser.parse(b, e);
+    }
+}
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <sstream>
+
+#include "../misc.hpp"
+#include "../res.hpp"
+#include "../simd.hpp"
+#include "first_set.hpp"
+
+namespace apc::parsers
+{
+    namespace char_class_ns
+    {
+        using namespace res;
+
+        // Set of bytes as a 256 bit bitmap, usable at compile time.
+        // Calling it tests a character, so it can also be given to take_while
+        struct CharSet
+        {
+            array<uint64_t, 4> bits{};
+
+            constexpr bool contains(unsigned char c) const
+            {
+                return (bits[c >> 6] >> (c & 63)) & 1;
+            }
+
+            constexpr bool operator()(char c) const
+            {
+                return contains(static_cast<unsigned char>(c));
+            }
+
+            constexpr CharSet& add(unsigned char c)
+            {
+                bits[c >> 6] |= uint64_t(1) << (c & 63);
+                return *this;
+            }
+
+            bitset<256> to_bitset() const
+            {
+                bitset<256> ret;
+                for (size_t c = 0; c < 256; c++)
+                {
+                    ret[c] = contains(static_cast<unsigned char>(c));
+                }
+                return ret;
+            }
+
+            friend constexpr CharSet operator|(CharSet a, const CharSet& b)
+            {
+                for (size_t n = 0; n < 4; n++)
+                {
+                    a.bits[n] |= b.bits[n];
+                }
+                return a;
+            }
+
+            friend constexpr CharSet operator&(CharSet a, const CharSet& b)
+            {
+                for (size_t n = 0; n < 4; n++)
+                {
+                    a.bits[n] &= b.bits[n];
+                }
+                return a;
+            }
+
+            friend constexpr CharSet operator~(CharSet a)
+            {
+                for (size_t n = 0; n < 4; n++)
+                {
+                    a.bits[n] = ~a.bits[n];
+                }
+                return a;
+            }
+        };
+
+        struct CharClassErr
+        {
+            NilErr prev;
+
+            char got;
+
+            constexpr CharClassErr(char got) : prev(), got(got) {}
+
+            tuple<string, size_t> description()
+            {
+                stringstream sstream;
+                sstream << "CharClass error because " << '"' << got << '"'
+                        << " is not in the class";
+
+                return { sstream.str(), 0 };
+            }
+        };
+
+        // Parses a single character of the set
+        struct CharClass
+        {
+            CharSet set;
+
+            using Ok = char;
+            using Err = CharClassErr;
+
+            constexpr CharClass(CharSet set) : set(set) {}
+
+            first_set_ns::FirstSet first_set() const
+            {
+                return set.to_bitset();
+            }
+
+            template< typename I >
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("char_class", b, [&]() -> Result<Ok, Err, I>
+                {
+                    if (b == e)
+                    {
+                        return EOI("CharClass");
+                    }
+
+                    if (set(*b))
+                    {
+                        return ok(*b, next(b));
+                    }
+
+                    return err(CharClassErr(*b), b);
+                });
+            }
+
+            friend constexpr CharClass operator|(const CharClass& a, const CharClass& b)
+            {
+                return a.set | b.set;
+            }
+
+            friend constexpr CharClass operator&(const CharClass& a, const CharClass& b)
+            {
+                return a.set & b.set;
+            }
+
+            friend constexpr CharClass operator~(const CharClass& a)
+            {
+                return ~a.set;
+            }
+        };
+
+        struct SpanErr
+        {
+            NilErr prev;
+
+            size_t expected_at_least;
+            size_t got;
+
+            constexpr SpanErr(size_t al, size_t got) : prev(), expected_at_least(al), got(got) {}
+
+            tuple<string, size_t> description()
+            {
+                stringstream sstream;
+                sstream << "Span error because expected at least " << expected_at_least
+                        << " characters of the class but got " << got;
+
+                return { sstream.str(), got };
+            }
+        };
+
+        // Longest run of characters of a class, returned as a string_view.
+        // Runs are scanned 16 or 32 bytes at a time when the input is contiguous
+        struct Span
+        {
+            simd::ClassTable table;
+
+            size_t _at_least;
+
+            using Ok = string_view;
+            using Err = SpanErr;
+
+            constexpr Span(const CharSet& set, size_t _at_least = 0)
+                : table(set.bits)
+                , _at_least(_at_least) {}
+
+            constexpr auto at_least(size_t n)&&
+            {
+                _at_least = n;
+                return move(*this);
+            }
+
+            // Like many, without a lower bound span succeeds on anything
+            first_set_ns::FirstSet first_set() const
+            {
+                if (_at_least > 0)
+                {
+                    return CharSet{ table.bits }.to_bitset();
+                }
+
+                return nullopt;
+            }
+
+            template< typename I >
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("span_of", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return scan(b, e)
+                        .fmap_ok([&b](auto& res_ok) -> Result<Ok, Err, I>
+                        {
+                            return ok(string_view(misc::to_pointer(b), distance(b, res_ok.pos)), res_ok.pos);
+                        });
+                });
+            }
+
+            template< typename I >
+            constexpr Result<NilOk, Err, I> recognize(I b, I e)
+            {
+                return instrument::probe("span_of", b, [&]() -> Result<NilOk, Err, I>
+                {
+                    return scan(b, e);
+                });
+            }
+
+        private:
+
+            template< typename I >
+            constexpr Result<NilOk, Err, I> scan(I b, I e)
+            {
+                static_assert(misc::is_contiguous_iterator_v<I>,
+                              "span_of requires contiguous input");
+
+                if (b >= e)
+                {
+                    return EOI("Span");
+                }
+
+                size_t n = distance(b, e);
+                size_t len = 0;
+                if (misc::is_constant_evaluated())
+                {
+                    for (; len < n && table.contains(static_cast<unsigned char>(b[len])); len++);
+                }
+                else
+                {
+                    len = simd::span(misc::to_pointer(b), n, table);
+                }
+
+                if (len == n && (len < _at_least || partial_input()))
+                {
+                    // the run may continue in the rest of the input
+                    return EOI("Span of {} characters", len);
+                }
+
+                if (len < _at_least)
+                {
+                    return err(SpanErr(_at_least, len), next(b, len));
+                }
+
+                return ok(NilOk{}, next(b, len));
+            }
+        };
+    }
+
+    using char_class_ns::CharSet;
+
+    constexpr auto char_class(CharSet set)
+    {
+        return char_class_ns::CharClass(set);
+    }
+
+    // Any of the characters of chars
+    constexpr auto one_of(const char* chars)
+    {
+        CharSet set;
+        for (; *chars != '\0'; chars++)
+        {
+            set.add(static_cast<unsigned char>(*chars));
+        }
+        return char_class(set);
+    }
+
+    // The characters from first to last, both included
+    constexpr auto range(char first, char last)
+    {
+        CharSet set;
+        for (int c = static_cast<unsigned char>(first); c <= static_cast<unsigned char>(last); c++)
+        {
+            set.add(static_cast<unsigned char>(c));
+        }
+        return char_class(set);
+    }
+
+    // Matches the longest run of characters of the class, see at_least
+    constexpr auto span_of(const char_class_ns::CharClass& cls)
+    {
+        return char_class_ns::Span(cls.set);
+    }
+}
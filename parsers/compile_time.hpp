@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdexcept>
+#include <string_view>
+
+#include "../res.hpp"
+
+namespace apc::parsers
+{
+    namespace compile_time_ns
+    {
+        // Not constexpr on purpose: reaching it in constant evaluation is a compile error
+        // that names it
+        inline void input_does_not_match_grammar()
+        {
+            throw invalid_argument("parse_constexpr: the input does not match the grammar");
+        }
+    }
+
+    // Parses all of text and returns the Ok value. Meant for constant evaluation,
+    //     static constexpr auto table = parse_constexpr(grammar, "...");
+    // costs nothing at run time and text that doesn't match stops the compilation.
+    // Needs C++20 and parsers that support it: unit, lit, any, nop, hide, map, raw,
+    // named, sequence, alt, many with fixed_capacity and char_class/span_of
+    template< typename P >
+    constexpr typename P::Ok parse_constexpr(P parser, string_view text)
+    {
+        const char* b = text.data();
+        const char* e = text.data() + text.size();
+
+        auto res = parser.parse(b, e);
+        if (!res.is_ok() || res.unwrap_ok().pos != e)
+        {
+            compile_time_ns::input_does_not_match_grammar();
+        }
+
+        return move(res.unwrap_ok().res);
+    }
+}
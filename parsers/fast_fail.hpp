@@ -0,0 +1,81 @@
+#pragma once
+
+#include <optional>
+
+#include "../res.hpp"
+
+namespace apc::parsers
+{
+    namespace fast_fail_ns
+    {
+        using namespace res;
+
+        // Error of a parse in fast fail mode. It only knows where the parse
+        // failed, the detailed error is rebuilt by parsing the input again.
+        // The parser and the input must outlive it
+        template< typename P, typename I >
+        struct FastErr
+        {
+            NilErr prev;
+
+            P* parser;
+            I begin;
+            I end;
+
+            FastErr(P* parser, I begin, I end)
+                : prev()
+                , parser(parser)
+                , begin(move(begin))
+                , end(move(end)) {}
+
+            // Detailed error of the same parse or nullopt if the parse doesn't fail anymore
+            optional<typename P::Err> materialize()
+            {
+                FastFailScope scope(false);
+                ParseScope parse;
+
+                auto res = parser->parse(begin, end);
+                if (res.is_err())
+                {
+                    return move(res.unwrap_err().err);
+                }
+
+                return nullopt;
+            }
+
+            tuple<string, size_t> description()
+            {
+                return { "Fast fail error", 0 };
+            }
+        };
+    }
+
+    // Runs the parser without filling in the details of its errors.
+    // Meant for grammars where most attempts fail and the reason doesn't matter.
+    // print_trace on the error parses the input again to describe it
+    template< typename P, typename I >
+    res::Result<typename P::Ok, fast_fail_ns::FastErr<P, I>, I> parse_fast(P& parser, I b, I e)
+    {
+        using namespace res;
+
+        auto res = [&]
+        {
+            FastFailScope scope(true);
+            ParseScope parse;
+            return parser.parse(b, e);
+        }();
+
+        if (res.is_ok())
+        {
+            return move(res.unwrap_ok());
+        }
+        else if (res.is_err())
+        {
+            return err(fast_fail_ns::FastErr<P, I>(&parser, b, e), res.unwrap_err().pos);
+        }
+        else
+        {
+            return move(res.unwrap_eoi());
+        }
+    }
+}
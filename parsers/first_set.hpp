@@ -0,0 +1,64 @@
+#pragma once
+
+#include <bitset>
+#include <optional>
+#include <utility>
+
+#include "../misc.hpp"
+#include "../res.hpp"
+
+namespace apc::parsers
+{
+    namespace first_set_ns
+    {
+        using namespace res;
+
+        // Bytes a match of a parser can start with.
+        // nullopt means that anything can start a match, which includes parsers
+        // that can succeed or fail without looking at the input
+        using FirstSet = optional<bitset<256>>;
+
+        template< typename P >
+        using first_set_t = decltype(declval<const P&>().first_set());
+
+        template< typename T >
+        FirstSet of_element(const T& t)
+        {
+            if constexpr (misc::is_byte_v<T>)
+            {
+                bitset<256> set;
+                set.set(static_cast<unsigned char>(t));
+                return set;
+            }
+            else
+            {
+                return nullopt;
+            }
+        }
+
+        inline FirstSet merge(const FirstSet& a, const FirstSet& b)
+        {
+            if (!a.has_value() || !b.has_value())
+            {
+                return nullopt;
+            }
+
+            return *a | *b;
+        }
+    }
+
+    // Parsers that know their first set provide a member `first_set`.
+    // A parser that does not is assumed to be able to start with anything
+    template< typename P >
+    first_set_ns::FirstSet first_set(const P& parser)
+    {
+        if constexpr (misc::is_detected_v<first_set_ns::first_set_t, P>)
+        {
+            return parser.first_set();
+        }
+        else
+        {
+            return nullopt;
+        }
+    }
+}
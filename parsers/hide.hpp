@@ -2,6 +2,9 @@
 
 #include <tuple>
 
+#include "first_set.hpp"
+#include "recognize.hpp"
+
 namespace apc::parsers
 {
     namespace hide_ns
@@ -16,22 +19,35 @@ namespace apc::parsers
             using Ok = NilOk;
             using Err = typename P::Err;
 
-            Hide(P parser) : parser(parser) {}
+            constexpr Hide(P parser) : parser(move(parser)) {}
+
+            first_set_ns::FirstSet first_set() const
+            {
+                return parsers::first_set(parser);
+            }
+
+            template< typename I >
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("hide", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return parsers::recognize(parser, b, e);
+                });
+            }
 
             template< typename I >
-            Result<Ok, Err, I> parse(I b, I e)
+            constexpr Result<Ok, Err, I> recognize(I b, I e)
             {
-                return parser.parse(b, e)
-                    .fmap_ok([](auto& res_ok) -> Result<Ok, Err, I>
-                    {
-                        return ok(NilOk{}, move(res_ok.pos));
-                    });
+                return instrument::probe("hide", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return parsers::recognize(parser, b, e);
+                });
             }
         };
     }
 
     template< typename P >
-    auto hide(P parser)
+    constexpr auto hide(P parser)
     {
         return hide_ns::Hide<P>(move(parser));
     }
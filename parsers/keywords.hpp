@@ -0,0 +1,294 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "alt.hpp"
+#include "first_set.hpp"
+#include "lit.hpp"
+
+namespace apc::parsers
+{
+    namespace keywords_ns
+    {
+        using namespace res;
+
+        enum class Match
+        {
+            First, // same as alt of lits: the first keyword in the list that matches
+            Longest, // the longest keyword that matches
+        };
+
+        constexpr size_t npos = size_t(-1);
+
+        // All keywords merged into a prefix tree stored as flat arrays
+        template< typename T >
+        struct Trie
+        {
+            using Elem = remove_cv_t<remove_reference_t<decltype(*begin(declval<const T&>()))>>;
+
+            struct Edge
+            {
+                Elem elem;
+                size_t target;
+            };
+
+            struct Node
+            {
+                size_t first_edge;
+                size_t n_edges;
+
+                size_t keyword; // index of the keyword ending here or npos
+                size_t min_below; // smallest keyword index among the descendants
+                size_t n_keywords; // number of keywords ending here or among the descendants
+            };
+
+            vector<T> keywords;
+            vector<Node> nodes;
+            vector<Edge> edges;
+
+            Trie(vector<T> kws) : keywords(move(kws))
+            {
+                struct BuildNode
+                {
+                    vector<pair<Elem, size_t>> children; // sorted by element
+                    size_t keyword = npos;
+                    size_t n_ending = 0;
+                };
+
+                vector<BuildNode> build(1);
+                for (size_t i = 0; i < keywords.size(); i++)
+                {
+                    size_t node = 0;
+                    for (const auto& elem : keywords[i])
+                    {
+                        auto& children = build[node].children;
+                        auto iter = lower_bound(children.begin(), children.end(), elem,
+                                                [](const auto& edge, const Elem& elem) { return edge.first < elem; });
+                        if (iter == children.end() || iter->first != elem)
+                        {
+                            iter = children.emplace(iter, elem, build.size());
+                        }
+                        node = iter->second;
+
+                        // may reallocate build, children isn't used after this
+                        if (node == build.size())
+                        {
+                            build.emplace_back();
+                        }
+                    }
+
+                    // duplicates keep the first index like alt would
+                    build[node].n_ending++;
+                    if (build[node].keyword == npos)
+                    {
+                        build[node].keyword = i;
+                    }
+                }
+
+                // children are created after their parents so a reverse pass sees them first
+                nodes.resize(build.size());
+                for (size_t n = build.size(); n-- > 0;)
+                {
+                    Node& node = nodes[n];
+                    node.keyword = build[n].keyword;
+                    node.min_below = npos;
+                    node.n_keywords = build[n].n_ending;
+
+                    for (const auto& [ elem, child ] : build[n].children)
+                    {
+                        node.min_below = min({ node.min_below, nodes[child].keyword, nodes[child].min_below });
+                        node.n_keywords += nodes[child].n_keywords;
+                    }
+                }
+
+                for (size_t n = 0; n < build.size(); n++)
+                {
+                    nodes[n].first_edge = edges.size();
+                    nodes[n].n_edges = build[n].children.size();
+
+                    for (const auto& [ elem, child ] : build[n].children)
+                    {
+                        edges.push_back(Edge{ elem, child });
+                    }
+                }
+            }
+
+            size_t child(size_t node, const Elem& elem) const
+            {
+                auto first = edges.begin() + nodes[node].first_edge;
+                auto last = first + nodes[node].n_edges;
+
+                auto iter = lower_bound(first, last, elem, [](const Edge& edge, const Elem& elem)
+                {
+                    return edge.elem < elem;
+                });
+
+                if (iter == last || iter->elem != elem)
+                {
+                    return npos;
+                }
+
+                return iter->target;
+            }
+        };
+
+        template< typename T, bool by_index = false, Match match = Match::First >
+        struct Keywords
+        {
+            shared_ptr<const Trie<T>> trie;
+
+            using Ok = conditional_t<by_index, size_t, T>;
+            using Err = alt_ns::AltErr;
+
+            Keywords(shared_ptr<const Trie<T>> trie) : trie(move(trie)) {}
+
+            // Prefer the longest matching keyword instead of the first one in the list
+            auto longest()&&
+            {
+                return Keywords<T, by_index, Match::Longest>(move(trie));
+            }
+
+            // Return the index of the matched keyword instead of the keyword itself
+            auto indexed()&&
+            {
+                return Keywords<T, true, match>(move(trie));
+            }
+
+            first_set_ns::FirstSet first_set() const
+            {
+                auto set = first_set_ns::FirstSet(bitset<256>());
+
+                for (const auto& keyword : trie->keywords)
+                {
+                    if (begin(keyword) == end(keyword))
+                    {
+                        return nullopt;
+                    }
+
+                    set = first_set_ns::merge(set, first_set_ns::of_element(*begin(keyword)));
+                }
+
+                return set;
+            }
+
+            template< typename I >
+            Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("keywords", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return parse_impl<Ok>(b, e);
+                });
+            }
+
+            template< typename I >
+            Result<NilOk, Err, I> recognize(I b, I e)
+            {
+                return instrument::probe("keywords", b, [&]() -> Result<NilOk, Err, I>
+                {
+                    return parse_impl<NilOk>(b, e);
+                });
+            }
+
+        private:
+
+            template< typename O, typename I >
+            Result<O, Err, I> parse_impl(I b, I e)
+            {
+                // the match may end before the furthest element looked at
+                [[maybe_unused]] auto point = misc::backtrack_point(b);
+
+                const auto& nodes = trie->nodes;
+
+                size_t node = 0;
+                size_t best = nodes[0].keyword;
+                I best_pos = b;
+
+                I iter = b;
+                bool hit_end = false;
+
+                while (true)
+                {
+                    // nothing below can come earlier in the list than what was already found
+                    if (match == Match::First && best != npos && nodes[node].min_below > best)
+                    {
+                        break;
+                    }
+
+                    if (iter == e)
+                    {
+                        hit_end = true;
+                        break;
+                    }
+
+                    size_t next_node = trie->child(node, *iter);
+                    if (next_node == npos)
+                    {
+                        break;
+                    }
+
+                    node = next_node;
+                    ++iter;
+
+                    size_t keyword = nodes[node].keyword;
+                    if (keyword != npos && (match == Match::Longest || keyword < best))
+                    {
+                        best = keyword;
+                        best_pos = iter;
+                    }
+                }
+
+                // a keyword further down could still win with more input
+                if (hit_end && nodes[node].min_below != npos && partial_input())
+                {
+                    return EOI("Keywords");
+                }
+
+                if (best != npos)
+                {
+                    if constexpr (is_same_v<O, NilOk>)
+                    {
+                        return ok(NilOk{}, best_pos);
+                    }
+                    else if constexpr (by_index)
+                    {
+                        return ok(best, best_pos);
+                    }
+                    else
+                    {
+                        return ok(trie->keywords[best], best_pos);
+                    }
+                }
+
+                // keywords below the last node ran out of input, the rest did not match
+                size_t n_keywords = trie->keywords.size();
+                size_t n_eoi = hit_end ? nodes[node].n_keywords : 0;
+
+                if (n_eoi == n_keywords)
+                {
+                    return EOI("Keywords");
+                }
+
+                return err(Err(n_keywords - n_eoi, n_eoi), b);
+            }
+        };
+    }
+
+    // Matches one of the keywords reading the input only once.
+    // Behaves like alt(lit(keywords)...) unless longest() is used
+    template< typename T >
+    auto keywords(vector<T> kws)
+    {
+        return keywords_ns::Keywords<T>(make_shared<const keywords_ns::Trie<T>>(move(kws)));
+    }
+
+    template< typename T, typename... Ts >
+    auto keywords(T keyword, Ts... kws)
+    {
+        using K = common_type_t<decltype(lit(keyword).lit), decltype(lit(kws).lit)...>;
+
+        return keywords(vector<K>{ K(lit(move(keyword)).lit), K(lit(move(kws)).lit)... });
+    }
+}
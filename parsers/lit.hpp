@@ -3,6 +3,9 @@
 #include <string>
 #include <sstream>
 
+#include "../simd.hpp"
+#include "first_set.hpp"
+
 namespace apc::parsers
 {
     namespace lit_ns
@@ -18,7 +21,7 @@ namespace apc::parsers
 
             size_t inner_offset;
 
-            LitErr(T expected, size_t inner_offset)
+            constexpr LitErr(T expected, size_t inner_offset)
                 : prev()
                 , expected(move(expected))
                 , inner_offset(inner_offset) {}
@@ -46,10 +49,126 @@ namespace apc::parsers
             using Ok = T;
             using Err = LitErr<T>;
 
-            Lit(T lit) : lit(move(lit)) {}
+            constexpr Lit(T lit) : lit(move(lit)) {}
+
+            first_set_ns::FirstSet first_set() const
+            {
+                if (begin(lit) == end(lit))
+                {
+                    return nullopt;
+                }
+
+                return first_set_ns::of_element(*begin(lit));
+            }
+
+            template< typename I >
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("lit", b, [&]() -> Result<Ok, Err, I>
+                {
+                    // the fast path compares with SIMD, which constant evaluation can't do
+                    if constexpr (has_fast_path<I>())
+                    {
+                        if (!misc::is_constant_evaluated())
+                        {
+                            return parse_contiguous(b, e);
+                        }
+                    }
+
+                    return parse_generic(b, e);
+                });
+            }
 
+            // Same as parse but without copying the literal into the result
             template< typename I >
-            Result<Ok, Err, I> parse(I b, I e)
+            constexpr Result<NilOk, Err, I> recognize(I b, I e)
+            {
+                return instrument::probe("lit", b, [&]() -> Result<NilOk, Err, I>
+                {
+                    if constexpr (has_fast_path<I>())
+                    {
+                        if (!misc::is_constant_evaluated())
+                        {
+                            return parse_contiguous<NilOk>(b, e);
+                        }
+                    }
+
+                    return parse_generic<NilOk>(b, e);
+                });
+            }
+
+            // Both the input and the literal are contiguous arrays of the same bytes
+            // so the whole literal can be compared at once
+            template< typename I >
+            static constexpr bool has_fast_path()
+            {
+                if constexpr (misc::is_contiguous_iterator_v<I> && misc::is_contiguous_v<T>)
+                {
+                    using V = remove_cv_t<misc::value_type_t<I>>;
+                    using L = remove_cv_t<remove_pointer_t<misc::data_t<T>>>;
+
+                    return is_same_v<V, L> && is_integral_v<V>;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            template< typename O = Ok >
+            constexpr O make_ok()
+            {
+                if constexpr (is_same_v<O, NilOk>)
+                {
+                    return NilOk{};
+                }
+                else
+                {
+                    return lit;
+                }
+            }
+
+            // In fast fail mode literals that are expensive to copy are left out of the error
+            constexpr LitErr<T> make_err(size_t inner_offset) const
+            {
+                if constexpr (is_default_constructible_v<T> && !is_trivially_copyable_v<T>)
+                {
+                    if (fast_fail())
+                    {
+                        return LitErr<T>(T(), inner_offset);
+                    }
+                }
+
+                return LitErr<T>(lit, inner_offset);
+            }
+
+            template< typename O = Ok, typename I >
+            Result<O, Err, I> parse_contiguous(I b, I e)
+            {
+                size_t lit_len = size(lit);
+                size_t avail = e - b;
+                size_t n = min(lit_len, avail);
+
+                if (n != 0)
+                {
+                    size_t mismatch = simd::mismatch(misc::to_pointer(b), data(lit), n);
+
+                    if (mismatch != n)
+                    {
+                        return err(make_err(mismatch), next(b, mismatch));
+                    }
+                }
+
+                if (avail < lit_len)
+                {
+                    return EOI("Lit");
+                }
+
+                return ok(make_ok<O>(), next(b, lit_len));
+            }
+
+            template< typename O = Ok, typename I >
+            constexpr Result<O, Err, I> parse_generic(I b, I e)
             {
                 I iter = b;
                 auto lit_iter = begin(lit);
@@ -57,7 +176,7 @@ namespace apc::parsers
                 {
                     if (*iter != *lit_iter)
                     {
-                        return err(LitErr<T>(lit, distance(b, iter)), iter);
+                        return err(make_err(distance(b, iter)), iter);
                     }
                 }
 
@@ -68,18 +187,18 @@ namespace apc::parsers
                     return EOI("Lit");
                 }
 
-                return ok(lit, next(b, lit_len));
+                return ok(make_ok<O>(), next(b, lit_len));
             }
         };
     }
 
     template< typename T >
-    enable_if_t<misc::is_iterable_v<T>, lit_ns::Lit<T>> lit(T t)
+    constexpr enable_if_t<misc::is_iterable_v<T>, lit_ns::Lit<T>> lit(T t)
     {
         return lit_ns::Lit<T>(move(t));
     }
 
-    lit_ns::Lit<string_view> lit(const char* t)
+    constexpr lit_ns::Lit<string_view> lit(const char* t)
     {
         return lit(string_view(t));
     }
@@ -2,13 +2,18 @@
 
 #include <vector>
 #include <functional>
+#include <limits>
 #include <optional>
 #include <sstream>
 #include <string>
-#include <vector>
+#include <memory_resource>
 
+#include "../small_vector.hpp"
+#include "../static_vector.hpp"
 #include "any.hpp"
+#include "first_set.hpp"
 #include "nop.hpp"
+#include "recognize.hpp"
 
 namespace apc::parsers
 {
@@ -36,8 +41,10 @@ namespace apc::parsers
 
             size_t inner_offset;
 
-            ManyErr(optional<E> prev, unsigned int al, unsigned int step, ManyErrCause cause, size_t offset)
-                : prev(move(prev))
+            // The error of the element or the delimiter, left out in fast fail mode
+            template< typename C >
+            constexpr ManyErr(C&& prev, unsigned int al, unsigned int step, ManyErrCause cause, size_t offset)
+                : prev(child_err<E>(forward<C>(prev)))
                 , expected_at_least(al)
                 , step(step)
                 , cause(cause)
@@ -74,12 +81,161 @@ namespace apc::parsers
             }
         };
 
-        template< typename P, template< typename > class C,
+        // Sinks decide what many returns. `start` creates the value and `add`
+        // puts every parsed element into it
+
+        template< typename C >
+        using reserve_t = decltype(declval<C&>().reserve(size_t()));
+
+        template< typename C >
+        using allocator_type_t = typename C::allocator_type;
+
+        // Containers with a polymorphic allocator take their memory from the
+        // resource of the parse context
+        template< typename C >
+        constexpr bool uses_context_resource()
+        {
+            if constexpr (misc::is_detected_v<allocator_type_t, C>)
+            {
+                return is_constructible_v<typename C::allocator_type, pmr::memory_resource*>;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        // Collects the elements into a container. A container that uses an
+        // allocator A is constructed from a copy of the given one
+        template< typename C, typename A = void >
+        struct ContainerSink
+        {
+            using Ok = C;
+
+            // recognize can skip the sink altogether
+            static constexpr bool has_effects = false;
+
+            // C++, do you even zero-sized types?
+            using Alloc = conditional_t< is_void_v<A>, unsigned char, A >;
+
+            Alloc alloc;
+
+            // space reserved up front, 0 leaves the container as it is constructed
+            size_t reserve;
+
+            constexpr ContainerSink(Alloc alloc = Alloc(), size_t reserve = 0)
+                : alloc(move(alloc))
+                , reserve(reserve) {}
+
+            constexpr C start() const
+            {
+                C container = [&]
+                {
+                    if constexpr (!is_void_v<A>)
+                    {
+                        return C(alloc);
+                    }
+                    else if constexpr (uses_context_resource<C>())
+                    {
+                        return C(typename C::allocator_type(res::memory_resource()));
+                    }
+                    else
+                    {
+                        return C();
+                    }
+                }();
+
+                if constexpr (misc::is_detected_v<reserve_t, C>)
+                {
+                    if (reserve != 0)
+                    {
+                        container.reserve(reserve);
+                    }
+                }
+
+                return container;
+            }
+
+            template< typename T >
+            constexpr void add(C& container, T&& elem)
+            {
+                container.push_back(forward<T>(elem));
+            }
+        };
+
+        // The most elements a container can hold, many stops there
+        template< typename C >
+        constexpr size_t fixed_capacity_v = numeric_limits<size_t>::max();
+
+        template< typename T, size_t N >
+        constexpr size_t fixed_capacity_v<containers::static_vector<T, N>> = N;
+
+        template< typename S >
+        constexpr size_t sink_capacity_v = numeric_limits<size_t>::max();
+
+        template< typename C, typename A >
+        constexpr size_t sink_capacity_v<ContainerSink<C, A>> = fixed_capacity_v<C>;
+
+        template< typename S >
+        constexpr bool is_container_sink_v = false;
+
+        template< typename C, typename A >
+        constexpr bool is_container_sink_v<ContainerSink<C, A>> = true;
+
+        // Combines the elements into one value with `acc = f(move(acc), elem)`
+        template< typename T, typename F >
+        struct FoldSink
+        {
+            T init;
+            F f;
+
+            using Ok = T;
+
+            static constexpr bool has_effects = false;
+
+            constexpr T start() const
+            {
+                return init;
+            }
+
+            template< typename U >
+            constexpr void add(T& acc, U&& elem)
+            {
+                acc = f(move(acc), forward<U>(elem));
+            }
+        };
+
+        // Passes every element to f as soon as it is parsed and returns how many there were
+        template< typename F >
+        struct ForEachSink
+        {
+            F f;
+
+            using Ok = size_t;
+
+            // f is called even when the result is thrown away
+            static constexpr bool has_effects = true;
+
+            constexpr size_t start() const
+            {
+                return 0;
+            }
+
+            template< typename U >
+            constexpr void add(size_t& n, U&& elem)
+            {
+                f(forward<U>(elem));
+                n++;
+            }
+        };
+
+        template< typename P, typename S,
                   bool hlb = false, // has lower bound
                   bool hub = false, // has upper bound
                   bool hc = false, // has condition
                   bool hd = false, // has delimiter
-                  typename D = nop_ns::Nop>
+                  typename D = nop_ns::Nop,
+                  typename W = void> // type of the condition
         struct Many
         {
             P parser;
@@ -90,7 +246,7 @@ namespace apc::parsers
             using AtLeast = conditional_t< hlb, size_t, unsigned char >;
             using AtMost = conditional_t< hub, size_t, unsigned char >;
 
-            using TakeWhile = conditional_t< hc, function<bool(typename P::Ok&)>, unsigned char >;
+            using TakeWhile = conditional_t< hc, W, unsigned char >;
             using DelimParser = conditional_t< hd, D, unsigned char >;
 
             AtLeast _at_least;
@@ -100,92 +256,230 @@ namespace apc::parsers
 
             DelimParser delim_parser;
 
+            S sink;
+
         public:
 
-            Many(P parser, AtLeast _at_least, AtMost _at_most, TakeWhile _take_while, DelimParser delim_parser)
+            constexpr Many(P parser, AtLeast _at_least, AtMost _at_most, TakeWhile _take_while, DelimParser delim_parser, S sink = S())
                 : parser(move(parser))
                 , _at_least(move(_at_least))
                 , _at_most(move(_at_most))
                 , _take_while(move(_take_while))
-                , delim_parser(move(delim_parser)) {}
+                , delim_parser(move(delim_parser))
+                , sink(move(sink)) {}
 
-            using Ok = C<typename P::Ok>;
+            using Ok = typename S::Ok;
             using Err = conditional_t< hd,
                                        ManyErr<variant< typename P::Err, typename D::Err >>,
                                        ManyErr<typename P::Err>
                                        >;
 
+            // Without a lower bound many succeeds on anything
+            first_set_ns::FirstSet first_set() const
+            {
+                if constexpr (hlb)
+                {
+                    if (_at_least > 0)
+                    {
+                        return parsers::first_set(parser);
+                    }
+                }
+
+                return nullopt;
+            }
+
             //TODO: check if moving stuff is necessary
-            auto at_least(size_t n)&&
+            constexpr auto at_least(size_t n)&&
             {
-                return Many<P, C, true, hub, hc, hd, D>(
+                return Many<P, S, true, hub, hc, hd, D, W>(
                     move(parser),
                     n, _at_most,
-                    move(_take_while), move(delim_parser)
+                    move(_take_while), move(delim_parser),
+                    move(sink)
                 );
             }
 
-            auto at_most(size_t n)&&
+            constexpr auto at_most(size_t n)&&
             {
-                return Many<P, C, hlb, true, hc, hd, D>(
+                return Many<P, S, hlb, true, hc, hd, D, W>(
                     move(parser),
                     _at_least, n,
-                    move(_take_while), move(delim_parser)
+                    move(_take_while), move(delim_parser),
+                    move(sink)
                 );
             }
 
-            auto take_while(function<bool(typename P::Ok&)> pred)&&
+            // The predicate is stored with its own type, so lambdas and
+            // function objects are inlined into the loop
+            template< typename F >
+            constexpr auto take_while(F pred)&&
             {
-                return Many<P, C, hlb, hub, true, hd, D>(
+                return Many<P, S, hlb, hub, true, hd, D, F>(
                     move(parser),
                     _at_least, _at_most,
-                    move(pred), move(delim_parser)
+                    move(pred), move(delim_parser),
+                    move(sink)
                 );
             }
 
-            auto take_until(function<bool(typename P::Ok&)> pred)&&
+            template< typename F >
+            constexpr auto take_until(F pred)&&
             {
-                return Many<P, C, hlb, hub, true, hd, D>(
+                return move(*this).take_while(not_fn(move(pred)));
+            }
+
+            template< typename NewD >
+            constexpr auto with_delim(NewD new_delim_parser)&&
+            {
+                return Many<P, S, hlb, hub, hc, true, NewD, W>(
                     move(parser),
                     _at_least, _at_most,
-                    not_fn(move(pred)), move(delim_parser)
+                    move(_take_while), move(new_delim_parser),
+                    move(sink)
                 );
             }
 
-            template< typename NewD >
-            auto with_delim(NewD new_delim_parser)&&
+            // Folds the elements into one value instead of collecting them
+            template< typename T, typename F >
+            constexpr auto fold(T init, F f)&&
+            {
+                return move(*this).with_sink(FoldSink<T, F>{ move(init), move(f) });
+            }
+
+            // Passes the elements to f instead of collecting them, returns their number
+            template< typename F >
+            constexpr auto for_each(F f)&&
+            {
+                return move(*this).with_sink(ForEachSink<F>{ move(f) });
+            }
+
+            // Reserves space for n elements before parsing, if the container can
+            constexpr auto reserve_hint(size_t n)&&
+            {
+                static_assert(is_container_sink_v<S>, "reserve_hint needs many to collect into a container");
+
+                sink.reserve = n;
+                return move(*this);
+            }
+
+            // Collects into a small_vector that stores up to N elements without allocating
+            template< size_t N >
+            constexpr auto inline_capacity()&&
+            {
+                static_assert(is_container_sink_v<S>, "inline_capacity needs many to collect into a container");
+
+                using Sink = ContainerSink<containers::small_vector<typename P::Ok, N>>;
+                return move(*this).with_sink(Sink(0, sink.reserve));
+            }
+
+            // Collects into a static_vector that stores up to N elements and never allocates.
+            // It is the container for many in constant evaluation. Like at_most(N), many
+            // stops after N elements and leaves the rest of the input
+            template< size_t N >
+            constexpr auto fixed_capacity()&&
             {
-                return Many<P, C, hlb, hub, hc, true, NewD>(
+                static_assert(is_container_sink_v<S>, "fixed_capacity needs many to collect into a container");
+
+                using Sink = ContainerSink<containers::static_vector<typename P::Ok, N>>;
+                return move(*this).with_sink(Sink());
+            }
+
+            // Hands the elements to a custom sink, see ContainerSink for what it needs
+            template< typename NewS >
+            constexpr auto with_sink(NewS new_sink)&&
+            {
+                return Many<P, NewS, hlb, hub, hc, hd, D, W>(
                     move(parser),
                     _at_least, _at_most,
-                    move(_take_while), move(new_delim_parser)
+                    move(_take_while), move(delim_parser),
+                    move(new_sink)
                 );
             }
 
             template< typename I >
-            Result<Ok, Err, I> parse(I b, I e)
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("many", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return parse_impl<true>(b, e);
+                });
+            }
+
+            // Same as parse but the elements are not collected into a container.
+            // They are not even built unless take_while or the sink needs to look at them
+            template< typename I >
+            constexpr Result<NilOk, Err, I> recognize(I b, I e)
             {
-                if (b >= e)
+                return instrument::probe("many", b, [&]() -> Result<NilOk, Err, I>
                 {
-                    return EOI("Many position 1");
+                    if constexpr (S::has_effects)
+                    {
+                        return parse_impl<true>(b, e)
+                            .fmap_ok([](auto& res_ok) -> Result<NilOk, Err, I>
+                            {
+                                return ok(NilOk{}, move(res_ok.pos));
+                            });
+                    }
+                    else
+                    {
+                        return parse_impl<false>(b, e);
+                    }
+                });
+            }
+
+        private:
+
+            template< bool build, typename I >
+            constexpr auto parse_element(I b, I e)
+            {
+                if constexpr (build || hc)
+                {
+                    return parser.parse(b, e);
+                }
+                else
+                {
+                    return parsers::recognize(parser, b, e);
+                }
+            }
+
+            template< bool build, typename I >
+            constexpr Result<conditional_t<build, Ok, NilOk>, Err, I> parse_impl(I b, I e)
+            {
+                if (b == e)
+                {
+                    return EOI("Many position {}", 1);
                 }
 
                 I iter = b;
                 size_t taken = 0;
-                C<typename P::Ok> ret;
+                conditional_t<build, Ok, NilOk> ret = [&]
+                {
+                    if constexpr (build)
+                    {
+                        return sink.start();
+                    }
+                    else
+                    {
+                        return NilOk{};
+                    }
+                }();
 
                 do
                 {
+                    // a failed delimiter or element ends the match at iter
+                    [[maybe_unused]] auto point = misc::backtrack_point(iter);
+
                     if constexpr (hd)
                     {
                         if (taken > 0)
                         {
-                            auto delim_res = delim_parser.parse(iter, e);
+                            auto delim_res = parsers::recognize(delim_parser, iter, e);
                             if (delim_res.is_eoi())
                             {
-                                if (taken < _at_least)
+                                // with partial input another element may still follow
+                                if (taken < _at_least || partial_input())
                                 {
-                                    delim_res.unwrap_eoi().trace.push_back("Many position "s + to_string(taken+1) + " delimiter");
+                                    delim_res.unwrap_eoi().push("Many position {} delimiter", taken+1);
                                     return move(delim_res.unwrap_eoi());
                                 }
 
@@ -200,7 +494,7 @@ namespace apc::parsers
                                         auto delim_err = move(delim_res.unwrap_err());
 
                                         return err(Err(
-                                                        delim_err.err,
+                                                        move(delim_err.err),
                                                         _at_least,
                                                         taken,
                                                         ManyErrCause::DelimiterFailed,
@@ -219,7 +513,7 @@ namespace apc::parsers
                         }
                     }
 
-                    auto res = parser.parse(iter, e);
+                    auto res = parse_element<build>(iter, e);
 
                     if (res.is_ok())
                     {
@@ -254,7 +548,10 @@ namespace apc::parsers
 
                         iter = res_ok.pos;
 
-                        ret.push_back(move(res_ok.res));
+                        if constexpr (build)
+                        {
+                            sink.add(ret, move(res_ok.res));
+                        }
                         taken++;
                     }
                     else if (res.is_err())
@@ -280,54 +577,83 @@ namespace apc::parsers
                     }
                     else
                     {
-                        if constexpr (hlb)
+                        if ((hlb && taken < _at_least) || partial_input())
                         {
-                            if (taken < _at_least)
-                            {
-                                auto res_eoi = move(res.unwrap_eoi());
+                            auto res_eoi = move(res.unwrap_eoi());
 
-                                res_eoi.trace.push_back("Many position "s + to_string(taken+1));
+                            res_eoi.push("Many position {}", taken+1);
 
-                                return res_eoi;
-                            }
+                            return res_eoi;
                         }
 
                         return ok(move(ret), iter);
                     }
-                } while (!hub || taken < _at_most);
+                } while ((!hub || taken < _at_most) && taken < sink_capacity_v<S>);
 
                 return ok(move(ret), iter);
             }
         };
     }
 
-    template< typename P, template< typename > class C = vector >
-    auto many(P parser)
+    template< typename P, template< typename... > class C = vector >
+    constexpr auto many(P parser)
     {
-        return many_ns::Many<P, C>(move(parser), 0, 0, 0, 0);
+        using Sink = many_ns::ContainerSink<C<typename P::Ok>>;
+        return many_ns::Many<P, Sink>(move(parser), 0, 0, 0, 0);
     }
 
-    template< typename T, template< typename > class C = vector >
-    auto many()
+    template< typename T, template< typename... > class C = vector >
+    constexpr auto many()
     {
         return many<any_ns::Any<T>, C>(any<T>());
     }
 
+    // Collects into a pmr::vector that takes its memory from the parse context, see parse_in
+    template< typename P >
+    auto many_pmr(P parser)
+    {
+        return many<P, pmr::vector>(move(parser));
+    }
+
+    template< typename P >
+    auto many_str_pmr(P parser)
+    {
+        return many<P, pmr::basic_string>(move(parser));
+    }
+
+    // Collects into any container type, for example small_vector<T, N> or a vector with its own allocator
+    template< typename C, typename P >
+    constexpr auto many_into(P parser)
+    {
+        using Sink = many_ns::ContainerSink<C>;
+        return many_ns::Many<P, Sink>(move(parser), 0, 0, 0, 0);
+    }
+
+    // Every result is constructed with a copy of alloc
+    template< typename C, typename P >
+    auto many_into(P parser, typename C::allocator_type alloc)
+    {
+        using Sink = many_ns::ContainerSink<C, typename C::allocator_type>;
+        return many_ns::Many<P, Sink>(move(parser), 0, 0, 0, 0, Sink(move(alloc)));
+    }
+
     template< typename P >
-    auto many_str(P parser)
+    constexpr auto many_str(P parser)
     {
-        return many_ns::Many<P, basic_string>(move(parser));
+        return many<P, basic_string>(move(parser));
     }
 
     template< typename T >
-    auto many_str()
+    constexpr auto many_str()
     {
         return many<any_ns::Any<T>, basic_string>(any<T>());
     }
 
-    auto many_space() {
+    // For whitespace that doesn't need to be copied, span_of is faster
+    inline auto many_space()
+    {
         return many_str<char>()
-            .take_while([](char& c) { return isspace(c); });
+            .take_while([](char c) { return isspace(static_cast<unsigned char>(c)) != 0; });
     }
 
 }
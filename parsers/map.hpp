@@ -1,5 +1,8 @@
 #pragma once
 
+#include "first_set.hpp"
+#include "recognize.hpp"
+
 namespace apc::parsers
 {
     namespace map_ns
@@ -15,24 +18,42 @@ namespace apc::parsers
             using Ok = invoke_result_t<F, typename P::Ok&&>;
             using Err = typename P::Err;
 
-            Map(P parser, F func)
+            constexpr Map(P parser, F func)
                 : parser(move(parser))
                 , func(move(func)) {}
 
+            first_set_ns::FirstSet first_set() const
+            {
+                return parsers::first_set(parser);
+            }
+
+            template< typename I >
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("map", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return parser.parse(b, e)
+                        .map_ok([this](auto& res_ok)
+                        {
+                            return ok(func(move(res_ok.res)), res_ok.pos);
+                        });
+                });
+            }
+
+            // The function is not applied when only the extent of the match is needed
             template< typename I >
-            Result<Ok, Err, I> parse(I b, I e)
+            constexpr Result<NilOk, Err, I> recognize(I b, I e)
             {
-                return parser.parse(b, e)
-                    .map_ok([this](auto& res_ok)
-                    {
-                        return ok(func(move(res_ok.res)), res_ok.pos);
-                    });
+                return instrument::probe("map", b, [&]() -> Result<NilOk, Err, I>
+                {
+                    return parsers::recognize(parser, b, e);
+                });
             }
         };
     }
 
     template< typename P, typename F >
-    auto map(P parser, F func)
+    constexpr auto map(P parser, F func)
     {
         return map_ns::Map<P, F>(move(parser), move(func));
     }
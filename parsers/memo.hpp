@@ -0,0 +1,322 @@
+#pragma once
+
+#include <any>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "first_set.hpp"
+
+namespace apc::parsers
+{
+    namespace memo_ns
+    {
+        using namespace res;
+
+        // Results of one parser for one input, keyed by position
+        template< typename P, typename I >
+        struct Cache
+        {
+            using R = Result<typename P::Ok, typename P::Err, I>;
+
+            static constexpr bool dense = is_base_of_v<random_access_iterator_tag,
+                                                        typename iterator_traits<I>::iterator_category>;
+
+            static constexpr size_t chunk_size = 32;
+
+            using Chunk = array<optional<R>, chunk_size>;
+
+            I end;
+            bool fast_fail;
+            bool partial_input;
+
+            // results the cache has room for, see max_entries
+            size_t n_slots;
+            size_t max_slots;
+
+            // random access input is indexed by the distance to the end, which
+            // doesn't depend on where the parse started. Only chunks of positions
+            // the parser ran at get slots
+            unordered_map<size_t, unique_ptr<Chunk>> chunks;
+
+            // the chunk used last, a parser mostly runs close to where it ran before
+            size_t last_index;
+            Chunk* last;
+
+            // other input is keyed by the address of the element, nullptr is the end
+            unordered_map<const void*, R> by_address;
+
+            // keys of chunks or of by_address in the order they were added, the
+            // oldest go first when the cache is full
+            deque<conditional_t<dense, size_t, const void*>> order;
+
+            Cache(I end, size_t max_slots)
+                : end(move(end))
+                , fast_fail(res::fast_fail())
+                , partial_input(res::partial_input())
+                , n_slots(0)
+                , max_slots(max_slots)
+                , last_index(size_t(-1))
+                , last(nullptr) {}
+
+            const R* lookup(const I& pos)
+            {
+                if constexpr (dense)
+                {
+                    size_t key = distance(pos, end);
+                    Chunk* chunk = find_chunk(key / chunk_size);
+                    if (chunk != nullptr && (*chunk)[key % chunk_size].has_value())
+                    {
+                        return &*(*chunk)[key % chunk_size];
+                    }
+                }
+                else
+                {
+                    auto iter = by_address.find(address(pos));
+                    if (iter != by_address.end())
+                    {
+                        return &iter->second;
+                    }
+                }
+
+                return nullptr;
+            }
+
+            void store(const I& pos, const R& res)
+            {
+                if constexpr (dense)
+                {
+                    size_t key = distance(pos, end);
+                    Chunk* chunk = find_chunk(key / chunk_size);
+                    if (chunk == nullptr)
+                    {
+                        make_room(chunk_size);
+
+                        order.push_back(key / chunk_size);
+                        auto& slot = chunks[key / chunk_size];
+                        slot = make_unique<Chunk>();
+                        n_slots += chunk_size;
+
+                        chunk = slot.get();
+                        last_index = key / chunk_size;
+                        last = chunk;
+                    }
+
+                    (*chunk)[key % chunk_size].emplace(res);
+                }
+                else
+                {
+                    if (by_address.count(address(pos)) == 0)
+                    {
+                        make_room(1);
+
+                        order.push_back(address(pos));
+                        by_address.emplace(address(pos), res);
+                        n_slots++;
+                    }
+                }
+            }
+
+            // Evicts the oldest results until n more fit
+            void make_room(size_t n)
+            {
+                while (!order.empty() && n_slots + n > max_slots)
+                {
+                    if constexpr (dense)
+                    {
+                        if (order.front() == last_index)
+                        {
+                            last_index = size_t(-1);
+                            last = nullptr;
+                        }
+
+                        chunks.erase(order.front());
+                        n_slots -= chunk_size;
+                    }
+                    else
+                    {
+                        by_address.erase(order.front());
+                        n_slots--;
+                    }
+
+                    order.pop_front();
+                }
+            }
+
+            Chunk* find_chunk(size_t index)
+            {
+                if (index == last_index)
+                {
+                    return last;
+                }
+
+                auto iter = chunks.find(index);
+                if (iter == chunks.end())
+                {
+                    return nullptr;
+                }
+
+                last_index = index;
+                last = iter->second.get();
+                return last;
+            }
+
+            const void* address(const I& pos)
+            {
+                return pos == end ? nullptr : static_cast<const void*>(addressof(*pos));
+            }
+
+            void clear()
+            {
+                chunks.clear();
+                last_index = size_t(-1);
+                last = nullptr;
+                by_address.clear();
+                order.clear();
+                n_slots = 0;
+            }
+        };
+
+        // The parser lives next to its cache, so copying a memo is cheap even
+        // when the grammar below it is large
+        template< typename P >
+        struct State
+        {
+            P parser;
+
+            // a Cache<P, I>* owned by the parse it was made in
+            std::any cache;
+            uint64_t parse;
+
+            // empties the cache while its parse lasts
+            void (*clear_cache)(std::any&);
+
+            size_t max_entries;
+        };
+
+        template< typename P >
+        struct Memo
+        {
+            shared_ptr<State<P>> state;
+
+            using Ok = typename P::Ok;
+            using Err = typename P::Err;
+
+            Memo(shared_ptr<State<P>> state) : state(move(state)) {}
+
+            // The oldest results are dropped to keep room for at most n results.
+            // Random access input gets room for chunks of 32 positions at once,
+            // so it keeps at least one chunk
+            auto max_entries(size_t n)&&
+            {
+                state->max_entries = n;
+                return move(*this);
+            }
+
+            // Copies of a memo share the cache, so this clears all of them
+            void clear()
+            {
+                state->cache.reset();
+                state->parse = 0;
+                state->clear_cache = nullptr;
+            }
+
+            first_set_ns::FirstSet first_set() const
+            {
+                return parsers::first_set(state->parser);
+            }
+
+            template< typename I >
+            Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("memo", b, [&]() -> Result<Ok, Err, I>
+                {
+                    ParseScope* scope = ParseScope::innermost();
+                    if (scope == nullptr)
+                    {
+                        // the parse didn't open a scope, the results last as long as this call
+                        ParseScope own;
+                        return run(own, b, e);
+                    }
+
+                    return run(*scope, b, e);
+                });
+            }
+
+        private:
+
+            template< typename I >
+            Result<Ok, Err, I> run(ParseScope& scope, I b, I e)
+            {
+                auto& cache = cache_for(scope, e);
+
+                if (auto* res = cache.lookup(b))
+                {
+                    return *res;
+                }
+
+                auto res = state->parser.parse(b, e);
+                cache.store(b, res);
+
+                return res;
+            }
+
+            // A new parse, a different end of input or a change of the fast fail
+            // or partial input mode starts a new cache
+            template< typename I >
+            Cache<P, I>& cache_for(ParseScope& scope, const I& e)
+            {
+                Cache<P, I>** cache = std::any_cast<Cache<P, I>*>(&state->cache);
+
+                if (cache == nullptr || state->parse != scope.id() || (*cache)->end != e ||
+                    (*cache)->fast_fail != res::fast_fail() ||
+                    (*cache)->partial_input != res::partial_input())
+                {
+                    // the scope keeps the old cache until it ends, its results go now
+                    if (state->parse == scope.id() && state->clear_cache != nullptr)
+                    {
+                        state->clear_cache(state->cache);
+                    }
+
+                    auto owned = make_shared<Cache<P, I>>(e, state->max_entries);
+                    scope.keep(owned);
+
+                    state->parse = scope.id();
+                    state->clear_cache = [](std::any& cache) { (*std::any_cast<Cache<P, I>*>(&cache))->clear(); };
+                    cache = &state->cache.template emplace<Cache<P, I>*>(owned.get());
+                }
+
+                return **cache;
+            }
+        };
+    }
+
+    // Remembers the results of the parser at every position it was run at so
+    // backtracking into it again costs only a lookup. Results are kept for one
+    // parse, which has to be started with parse_memoized for memos to share them.
+    // Any other outermost call is a parse of its own, so nothing is reused from
+    // one top level call to the next. The cache is shared between copies of
+    // the memo and is not thread safe
+    template< typename P >
+    auto memo(P parser)
+    {
+        auto state = make_shared<memo_ns::State<P>>(memo_ns::State<P>{ move(parser), std::any(), 0, nullptr, size_t(-1) });
+        return memo_ns::Memo<P>(move(state));
+    }
+
+    // Runs the parser as one parse: the memos in it reuse their results anywhere
+    // in it and drop them at the end. Without it results last only as long as
+    // the outermost memo call they were made in, so memos that don't run inside
+    // each other, such as in the branches of an alt, don't share them
+    template< typename P, typename I >
+    auto parse_memoized(P& parser, I b, I e)
+    {
+        res::ParseScope scope;
+        return parser.parse(b, e);
+    }
+}
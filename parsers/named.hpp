@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+
+#include "../instrument.hpp"
+#include "../profile.hpp"
+#include "first_set.hpp"
+#include "recognize.hpp"
+
+namespace apc::parsers
+{
+    namespace named_ns
+    {
+        using namespace res;
+
+        template< typename E >
+        struct NamedErr
+        {
+            E prev;
+
+            const char* label;
+
+            constexpr NamedErr(E prev, const char* label)
+                : prev(move(prev))
+                , label(label) {}
+
+            tuple<string, size_t> description()
+            {
+                return { string("In ") + label, 0 };
+            }
+        };
+
+        // Same as the parser, but its failures name the label in their traces,
+        // instrumentation counts everything done inside it under the label and
+        // the profiler times it as a rule. The label must outlive the results
+        // and the counters, a string literal is best
+        template< typename P >
+        struct Named
+        {
+            P parser;
+            const char* label;
+
+            using Ok = typename P::Ok;
+            using Err = NamedErr<typename P::Err>;
+
+            constexpr Named(P parser, const char* label)
+                : parser(move(parser))
+                , label(label) {}
+
+            first_set_ns::FirstSet first_set() const
+            {
+                return parsers::first_set(parser);
+            }
+
+            template< typename I >
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::with_label(label, [&]
+                {
+                    return profile::run(label, b, e, [&]
+                    {
+                        return name(parser.parse(b, e));
+                    });
+                });
+            }
+
+            template< typename I >
+            constexpr Result<NilOk, Err, I> recognize(I b, I e)
+            {
+                return instrument::with_label(label, [&]
+                {
+                    return profile::run(label, b, e, [&]
+                    {
+                        return name(parsers::recognize(parser, b, e));
+                    });
+                });
+            }
+
+        private:
+
+            template< typename T, typename I >
+            constexpr Result<T, Err, I> name(Result<T, typename P::Err, I>&& res)
+            {
+                if (res.is_ok())
+                {
+                    return move(res.unwrap_ok());
+                }
+                else if (res.is_err())
+                {
+                    return err(Err(move(res.unwrap_err().err), label), res.unwrap_err().pos);
+                }
+                else
+                {
+                    // the label is printed as it is, braces in it are not placeholders.
+                    // Constant evaluation can't keep a pointer in the argument
+                    if (misc::is_constant_evaluated())
+                    {
+                        res.unwrap_eoi().push(label);
+                    }
+                    else
+                    {
+                        res.unwrap_eoi().push("{s}", reinterpret_cast<uintptr_t>(label));
+                    }
+                    return move(res.unwrap_eoi());
+                }
+            }
+        };
+    }
+
+    // Gives the parser a name for error traces, instrumentation and the profiler
+    template< typename P >
+    constexpr auto named(P parser, const char* label)
+    {
+        return named_ns::Named<P>(move(parser), label);
+    }
+}
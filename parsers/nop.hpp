@@ -11,17 +11,20 @@ namespace apc::parsers
             using Ok = NilOk;
             using Err = NilErr;
 
-            Nop() {}
+            constexpr Nop() {}
 
             template< typename I >
-            Result<Ok, Err, I> parse(I b, I e)
+            constexpr Result<Ok, Err, I> parse(I b, I e)
             {
-                return ok(NilOk{}, b);
+                return instrument::probe("nop", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return ok(NilOk{}, b);
+                });
             }
         };
     }
 
-    nop_ns::Nop nop()
+    constexpr nop_ns::Nop nop()
     {
         return nop_ns::Nop{};
     }
@@ -0,0 +1,432 @@
+#pragma once
+
+#include <bitset>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include "../misc.hpp"
+#include "../res.hpp"
+#include "first_set.hpp"
+
+namespace apc::parsers
+{
+    namespace number_ns
+    {
+        using namespace res;
+
+        struct NumberErr
+        {
+            NilErr prev;
+
+            // invalid_argument when there is no number, result_out_of_range
+            // when the number doesn't fit the type
+            errc reason;
+
+            // characters of the number that is out of range
+            size_t length;
+
+            NumberErr(errc reason, size_t length)
+                : prev()
+                , reason(reason)
+                , length(length) {}
+
+            tuple<string, size_t> description()
+            {
+                stringstream sstream;
+                if (reason == errc::result_out_of_range)
+                {
+                    sstream << "Number error because the " << length << " characters long number is out of range";
+                }
+                else
+                {
+                    sstream << "Number error: expected a number";
+                }
+                return { sstream.str(), 0 };
+            }
+        };
+
+        template< typename I >
+        constexpr bool is_char_input_v = misc::is_contiguous_iterator_v<I> && is_same_v<remove_cv_t<misc::value_type_t<I>>, char>;
+
+        // The end of the number at ptr and the outcome of from_chars. The number
+        // may continue after the input when it reaches the end
+        template< typename T, typename I >
+        Result<T, NumberErr, I> finish(I b, size_t avail, size_t len, errc ec, T value, bool sign_only, const char* name)
+        {
+            if (ec == errc::invalid_argument)
+            {
+                if (sign_only)
+                {
+                    return EOI(name);
+                }
+
+                return err(NumberErr(ec, 0), b);
+            }
+
+            if (len == avail && partial_input())
+            {
+                return EOI(name);
+            }
+
+            if (ec == errc::result_out_of_range)
+            {
+                return err(NumberErr(ec, len), b);
+            }
+
+            return ok(value, next(b, len));
+        }
+
+        // An integer the way from_chars reads it: digits of the base and a '-'
+        // for signed types. No '+', no spaces and no "0x"
+        template< typename T >
+        struct Integer
+        {
+            static_assert(is_integral_v<T> && !is_same_v<T, bool>, "integer needs an integral type");
+
+            int base;
+
+            using Ok = T;
+            using Err = NumberErr;
+
+            Integer(int base) : base(base) {}
+
+            first_set_ns::FirstSet first_set() const
+            {
+                bitset<256> set;
+                for (int d = 0; d < base; d++)
+                {
+                    if (d < 10)
+                    {
+                        set.set('0' + d);
+                    }
+                    else
+                    {
+                        set.set('a' + d - 10);
+                        set.set('A' + d - 10);
+                    }
+                }
+
+                if constexpr (is_signed_v<T>)
+                {
+                    set.set('-');
+                }
+
+                return set;
+            }
+
+            template< typename I >
+            Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("integer", b, [&]() -> Result<Ok, Err, I>
+                {
+                    if constexpr (is_char_input_v<I>)
+                    {
+                        return parse_contiguous(b, e);
+                    }
+                    else
+                    {
+                        return parse_generic(b, e);
+                    }
+                });
+            }
+
+        private:
+
+            template< typename I >
+            Result<Ok, Err, I> parse_contiguous(I b, I e)
+            {
+                if (b == e)
+                {
+                    return EOI("Integer");
+                }
+
+                const char* p = misc::to_pointer(b);
+                size_t n = distance(b, e);
+
+                T value = 0;
+                from_chars_result res = base == 10 ? decimal(p, p + n, value) : from_chars(p, p + n, value, base);
+
+                return finish(b, n, size_t(res.ptr - p), res.ec, value, is_signed_v<T> && n == 1 && *p == '-', "Integer");
+            }
+
+            // Up to 16 digits are read 8 at a time, from_chars takes over
+            // for numbers too long to fit in 64 bits without checks
+            static from_chars_result decimal(const char* p, const char* end, T& value)
+            {
+                bool negative = is_signed_v<T> && *p == '-';
+                const char* digits = p + negative;
+                const char* iter = digits;
+
+                uint64_t acc = 0;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                while (end - iter >= 8 && iter - digits < 16)
+                {
+                    uint64_t chunk;
+                    memcpy(&chunk, iter, 8);
+                    if (!eight_digits(chunk))
+                    {
+                        break;
+                    }
+
+                    acc = acc * 100000000 + eight_digits_value(chunk);
+                    iter += 8;
+                }
+#endif
+
+                for (; iter != end && iter - digits < 19 && unsigned(*iter - '0') < 10; iter++)
+                {
+                    acc = acc * 10 + unsigned(*iter - '0');
+                }
+
+                if (iter == digits)
+                {
+                    return { p, errc::invalid_argument };
+                }
+
+                if (iter != end && unsigned(*iter - '0') < 10)
+                {
+                    return from_chars(p, end, value, 10);
+                }
+
+                using U = make_unsigned_t<T>;
+                uint64_t limit = uint64_t(numeric_limits<T>::max()) + negative;
+                if (acc > limit)
+                {
+                    return { iter, errc::result_out_of_range };
+                }
+
+                value = static_cast<T>(negative ? U(0) - U(acc) : U(acc));
+                return { iter, errc() };
+            }
+
+            // Every byte is an ASCII digit
+            static bool eight_digits(uint64_t chunk)
+            {
+                return (((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+                        == 0x3333333333333333);
+            }
+
+            // The first character is the lowest byte: pairs, then fours, then all eight
+            static uint64_t eight_digits_value(uint64_t chunk)
+            {
+                chunk -= 0x3030303030303030;
+                chunk = chunk * 10 + (chunk >> 8);
+                chunk = ((chunk & 0x000000FF000000FF) * (100 + (1000000ull << 32))
+                         + ((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ull << 32))) >> 32;
+                return chunk & 0xFFFFFFFF;
+            }
+
+            int digit_value(char c) const
+            {
+                int d = c >= '0' && c <= '9' ? c - '0'
+                      : c >= 'a' && c <= 'z' ? c - 'a' + 10
+                      : c >= 'A' && c <= 'Z' ? c - 'A' + 10
+                      : -1;
+                return d < base ? d : -1;
+            }
+
+            template< typename I >
+            Result<Ok, Err, I> parse_generic(I b, I e)
+            {
+                using U = make_unsigned_t<T>;
+
+                I iter = b;
+                bool negative = false;
+                if constexpr (is_signed_v<T>)
+                {
+                    if (iter != e && *iter == '-')
+                    {
+                        negative = true;
+                        ++iter;
+                    }
+                }
+
+                U acc = 0;
+                bool overflow = false;
+                size_t len = negative;
+                for (; iter != e; ++iter, len++)
+                {
+                    int d = digit_value(*iter);
+                    if (d < 0)
+                    {
+                        break;
+                    }
+
+                    overflow |= __builtin_mul_overflow(acc, U(base), &acc);
+                    overflow |= __builtin_add_overflow(acc, U(d), &acc);
+                }
+
+                if (len == size_t(negative))
+                {
+                    return finish(b, len, 0, errc::invalid_argument, T(), iter == e, "Integer");
+                }
+
+                overflow |= acc > U(numeric_limits<T>::max()) + U(negative);
+                T value = static_cast<T>(negative ? U(0) - acc : acc);
+
+                errc ec = overflow ? errc::result_out_of_range : errc();
+                return finish(b, iter == e ? len : len + 1, len, ec, value, false, "Integer");
+            }
+        };
+
+        // A floating point number the way from_chars reads it with format,
+        // which includes "inf" and "nan" but not a leading '+'
+        template< typename T >
+        struct Floating
+        {
+            static_assert(is_floating_point_v<T>, "floating needs a floating point type");
+
+            chars_format format;
+
+            using Ok = T;
+            using Err = NumberErr;
+
+            Floating(chars_format format) : format(format) {}
+
+            first_set_ns::FirstSet first_set() const
+            {
+                bitset<256> set;
+                for (const char* c = format == chars_format::hex ? "0123456789abcdefABCDEF-.iInN" : "0123456789-.iInN"; *c != '\0'; c++)
+                {
+                    set.set(static_cast<unsigned char>(*c));
+                }
+                return set;
+            }
+
+            template< typename I >
+            Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("floating", b, [&]() -> Result<Ok, Err, I>
+                {
+                    if (b == e)
+                    {
+                        return EOI("Floating");
+                    }
+
+                    if constexpr (is_char_input_v<I>)
+                    {
+                        return parse_chars(b, misc::to_pointer(b), distance(b, e));
+                    }
+                    else
+                    {
+                        return parse_copied(b, e);
+                    }
+                });
+            }
+
+        private:
+
+            // Longer than any number a program prints, "-1.7976931348623157e+308" has 24
+            static constexpr size_t stack_chars = 128;
+
+            // from_chars needs the characters in one piece. They are copied to the
+            // stack, only a longer run of characters that may be in a number is
+            // copied to the heap
+            template< typename I >
+            Result<Ok, Err, I> parse_copied(I b, I e)
+            {
+                [[maybe_unused]] auto point = misc::backtrack_point(b);
+
+                // one more for the character after the end of a token
+                char chars[stack_chars + 1];
+                size_t n = 0;
+
+                I iter = b;
+                for (; iter != e && n < stack_chars && may_be_in_number(*iter); ++iter)
+                {
+                    chars[n++] = *iter;
+                }
+
+                // the rest of the input counts as one more character if there is any
+                if (iter == e || !may_be_in_number(*iter))
+                {
+                    chars[n] = '\0';
+                    return parse_chars(b, chars, n + (iter != e));
+                }
+
+                string long_chars(chars, n);
+                for (; iter != e && may_be_in_number(*iter); ++iter)
+                {
+                    long_chars.push_back(*iter);
+                }
+
+                return parse_chars(b, long_chars.data(), long_chars.size() + (iter != e));
+            }
+
+            template< typename I >
+            Result<Ok, Err, I> parse_chars(I b, const char* p, size_t n)
+            {
+                T value = 0;
+                auto [ptr, ec] = from_chars(p, p + n, value, format);
+
+                bool sign_only = true;
+                for (size_t k = 0; k < n && sign_only; k++)
+                {
+                    sign_only = p[k] == '-' || p[k] == '.';
+                }
+
+                size_t len = size_t(ptr - p);
+
+                // "1.5e" and "1.5e-" at the end of partial input may still get exponent digits
+                if (ec == errc() && partial_input() && cut_in_exponent(ptr, n - len))
+                {
+                    return EOI("Floating");
+                }
+
+                return finish(b, n, len, ec, value, sign_only, "Floating");
+            }
+
+            // The rest of the input is the start of an exponent without digits
+            bool cut_in_exponent(const char* rest, size_t n) const
+            {
+                bool hex = format == chars_format::hex;
+                if (!hex && (format & chars_format::scientific) != chars_format::scientific)
+                {
+                    return false;
+                }
+
+                if (n == 0 || n > 2 || (hex ? (rest[0] != 'p' && rest[0] != 'P') : (rest[0] != 'e' && rest[0] != 'E')))
+                {
+                    return false;
+                }
+
+                return n == 1 || rest[1] == '-' || rest[1] == '+';
+            }
+
+            static bool may_be_in_number(char c)
+            {
+                return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+                    || c == '-' || c == '+' || c == '.' || c == '(' || c == ')' || c == '_';
+            }
+        };
+    }
+
+    //     sequence(integer<uint16_t>(), unit(':'), integer<uint8_t>(16))
+    // reads digits of base straight from the input, parsing a number costs
+    // no more than scanning it. Fails with NumberErr when there is no number
+    // or it is out of range of T
+    template< typename T = int >
+    auto integer(int base = 10)
+    {
+        if (base < 2 || base > 36)
+        {
+            throw invalid_argument("integer: the base must be between 2 and 36");
+        }
+
+        return number_ns::Integer<T>(base);
+    }
+
+    template< typename T = double >
+    auto floating(chars_format format = chars_format::general)
+    {
+        return number_ns::Floating<T>(format);
+    }
+}
@@ -0,0 +1,437 @@
+#pragma once
+
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <variant>
+#include <vector>
+
+#include "../misc.hpp"
+#include "../res.hpp"
+#include "../thread_pool.hpp"
+#include "first_set.hpp"
+#include "many.hpp"
+#include "recognize.hpp"
+
+namespace apc::parsers
+{
+    namespace parallel_many_ns
+    {
+        using namespace res;
+        using many_ns::ManyErr;
+        using many_ns::ManyErrCause;
+
+        // Why the records of a chunk stopped
+        enum class Stop
+        {
+            Boundary,  // reached the start of the next chunk
+            Overran,   // a record or delimiter crossed the start of the next chunk
+            RecordErr,
+            RecordEOI,
+            DelimErr,
+            DelimEOI,
+        };
+
+        template< typename Ok, typename E, typename I >
+        struct Chunk
+        {
+            vector<Ok> values;
+
+            Stop stop;
+
+            // where the result of many would end
+            I pos;
+
+            // position of a record error
+            I err_pos;
+
+            // continuing after an overrun starts with a delimiter
+            bool delim_next;
+
+            optional<E> err;
+            EOI eoi;
+        };
+
+        // Same as many(record).with_delim(delim) but the input is split into chunks
+        // at delimiters and the chunks are parsed on a thread pool.
+        // The delimiter may only appear between records or inside quotes (see quoted),
+        // other splits are detected and parsed again on the calling thread.
+        // Records are parsed by copies of the parser, so it must be safe to use
+        // copies on several threads at once (memo is not)
+        template< typename P, typename D >
+        struct ParallelMany
+        {
+            P record;
+            D delim;
+
+            using Ok = vector<typename P::Ok>;
+            using Err = ManyErr<variant< typename P::Err, typename D::Err >>;
+
+        private:
+
+            using InnerErr = variant< typename P::Err, typename D::Err >;
+
+            size_t _at_least;
+
+            // -1 when records are not quoted
+            int quote;
+
+            size_t _min_chunk;
+
+            shared_ptr<concurrency::WorkStealingPool> pool;
+
+        public:
+
+            // 0 threads uses one per core
+            ParallelMany(P record, D delim, size_t threads)
+                : record(move(record))
+                , delim(move(delim))
+                , _at_least(0)
+                , quote(-1)
+                , _min_chunk(64 * 1024)
+                , pool(make_shared<concurrency::WorkStealingPool>(threads)) {}
+
+            first_set_ns::FirstSet first_set() const
+            {
+                if (_at_least > 0)
+                {
+                    return parsers::first_set(record);
+                }
+
+                return nullopt;
+            }
+
+            auto at_least(size_t n)&&
+            {
+                _at_least = n;
+                return move(*this);
+            }
+
+            // Delimiters between two quote characters are part of a record.
+            // Doubled quotes inside a quoted field, as in CSV, are handled too
+            auto quoted(char q = '"')&&
+            {
+                quote = static_cast<unsigned char>(q);
+                return move(*this);
+            }
+
+            // Inputs are not split into chunks smaller than n elements
+            auto min_chunk(size_t n)&&
+            {
+                _min_chunk = n;
+                return move(*this);
+            }
+
+            template< typename I >
+            Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("parallel_many", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return parse_chunks(b, e);
+                });
+            }
+
+        private:
+
+            template< typename I >
+            Result<Ok, Err, I> parse_chunks(I b, I e)
+            {
+                static_assert(is_base_of_v<random_access_iterator_tag, typename iterator_traits<I>::iterator_category>,
+                              "parallel_many requires random access input");
+
+                if (b >= e)
+                {
+                    return EOI("Many position {}", 1);
+                }
+
+                vector<I> starts = split(b, e);
+                size_t n_chunks = starts.size();
+
+                if (n_chunks == 1)
+                {
+                    auto chunk = run(record, delim, b, false, e, true, e);
+                    Ok values = move(chunk.values);
+                    return finish(b, values, move(chunk));
+                }
+
+                vector<Chunk<typename P::Ok, InnerErr, I>> chunks(n_chunks);
+
+                // the workers parse in the same mode as the calling thread
+                bool ff = fast_fail();
+                bool pi = partial_input();
+
+                pool->run(n_chunks, [&](size_t n)
+                {
+                    FastFailScope ff_scope(ff);
+                    PartialInputScope pi_scope(pi);
+
+                    P record_copy = record;
+                    D delim_copy = delim;
+
+                    bool last = n + 1 == n_chunks;
+                    chunks[n] = run(record_copy, delim_copy, starts[n], false, last ? e : starts[n + 1], last, e);
+                });
+
+                // merged in input order up to the first chunk that didn't end at the next one
+                size_t total = 0;
+                for (auto& chunk : chunks)
+                {
+                    total += chunk.values.size();
+                }
+
+                Ok values;
+                values.reserve(total);
+
+                for (size_t n = 0; n < n_chunks; n++)
+                {
+                    auto& chunk = chunks[n];
+                    move(chunk.values.begin(), chunk.values.end(), back_inserter(values));
+
+                    if (chunk.stop == Stop::Boundary)
+                    {
+                        continue;
+                    }
+
+                    if (chunk.stop == Stop::Overran)
+                    {
+                        // the splits after this one were wrong, the rest is parsed here
+                        auto rest = run(record, delim, chunk.pos, chunk.delim_next, e, true, e);
+                        move(rest.values.begin(), rest.values.end(), back_inserter(values));
+
+                        return finish(b, values, move(rest));
+                    }
+
+                    return finish(b, values, move(chunk));
+                }
+
+                // the last chunk always stops for a reason of its own
+                return finish(b, values, move(chunks.back()));
+            }
+
+            // Parses records until the boundary or until many would stop
+            template< typename I >
+            static Chunk<typename P::Ok, InnerErr, I> run(P& record, D& delim, I from, bool delim_next, I boundary, bool last, I e)
+            {
+                Chunk<typename P::Ok, InnerErr, I> chunk;
+                I iter = from;
+
+                auto stop = [&](Stop why)
+                {
+                    chunk.stop = why;
+                    chunk.pos = iter;
+                    chunk.delim_next = delim_next;
+                    return move(chunk);
+                };
+
+                while (true)
+                {
+                    if (delim_next)
+                    {
+                        auto delim_res = parsers::recognize(delim, iter, e);
+                        if (delim_res.is_eoi())
+                        {
+                            chunk.eoi = move(delim_res.unwrap_eoi());
+                            return stop(Stop::DelimEOI);
+                        }
+                        else if (delim_res.is_err())
+                        {
+                            chunk.err.emplace(in_place_index<1>, move(delim_res.unwrap_err().err));
+                            return stop(Stop::DelimErr);
+                        }
+
+                        iter = delim_res.unwrap_ok().pos;
+                        delim_next = false;
+
+                        if (!last && iter >= boundary)
+                        {
+                            return stop(iter == boundary ? Stop::Boundary : Stop::Overran);
+                        }
+                    }
+
+                    auto res = record.parse(iter, e);
+                    if (res.is_err())
+                    {
+                        chunk.err_pos = res.unwrap_err().pos;
+                        chunk.err.emplace(in_place_index<0>, move(res.unwrap_err().err));
+                        return stop(Stop::RecordErr);
+                    }
+                    else if (res.is_eoi())
+                    {
+                        chunk.eoi = move(res.unwrap_eoi());
+                        return stop(Stop::RecordEOI);
+                    }
+
+                    chunk.values.push_back(move(res.unwrap_ok().res));
+                    iter = res.unwrap_ok().pos;
+                    delim_next = true;
+
+                    if (!last && iter >= boundary)
+                    {
+                        return stop(Stop::Overran);
+                    }
+                }
+            }
+
+            // The result many would return after stopping the same way
+            template< typename I >
+            Result<Ok, Err, I> finish(I b, Ok& values, Chunk<typename P::Ok, InnerErr, I> chunk)
+            {
+                size_t taken = values.size();
+
+                switch (chunk.stop)
+                {
+                    case Stop::RecordErr:
+                        if (taken < _at_least)
+                        {
+                            return err(Err(move(chunk.err), _at_least, taken, ManyErrCause::ParserFailed, distance(b, chunk.pos)),
+                                       chunk.err_pos);
+                        }
+                        break;
+
+                    case Stop::DelimErr:
+                        if (taken < _at_least)
+                        {
+                            return err(Err(move(chunk.err), _at_least, taken, ManyErrCause::DelimiterFailed, distance(b, chunk.pos)),
+                                       chunk.pos);
+                        }
+                        break;
+
+                    case Stop::RecordEOI:
+                        if (taken < _at_least || partial_input())
+                        {
+                            chunk.eoi.push("Many position {}", taken+1);
+                            return move(chunk.eoi);
+                        }
+                        break;
+
+                    case Stop::DelimEOI:
+                        if (taken < _at_least || partial_input())
+                        {
+                            chunk.eoi.push("Many position {} delimiter", taken+1);
+                            return move(chunk.eoi);
+                        }
+                        break;
+
+                    default:
+                        break;
+                }
+
+                return ok(move(values), chunk.pos);
+            }
+
+            // Start of every chunk. Splits are placed right after a delimiter near
+            // evenly spaced offsets
+            template< typename I >
+            vector<I> split(I b, I e)
+            {
+                vector<I> starts{ b };
+
+                size_t n = distance(b, e);
+                size_t n_chunks = min(pool->size() * 4, n / max<size_t>(_min_chunk, 1));
+
+                if (pool->size() == 1 || n_chunks < 2)
+                {
+                    return starts;
+                }
+
+                // speculative splits assume that the offsets are outside of quotes
+                for (size_t k = 1; k < n_chunks; k++)
+                {
+                    I target = next(b, n * k / n_chunks);
+                    if (target <= starts.back())
+                    {
+                        continue;
+                    }
+
+                    I s = find_delim(target, e, false);
+                    if (s < e && s > starts.back())
+                    {
+                        starts.push_back(s);
+                    }
+                }
+
+                if (quote < 0 || starts.size() == 1)
+                {
+                    return starts;
+                }
+
+                // quote-state fix-up: the chunks count their quotes in parallel and a split
+                // with an odd number of quotes before it is moved to the next delimiter
+                // after the closing quote
+                vector<size_t> quotes(starts.size());
+                pool->run(starts.size(), [&](size_t k)
+                {
+                    I to = k + 1 < starts.size() ? starts[k + 1] : e;
+                    quotes[k] = count_if(starts[k], to, [this](const auto& x) { return is_quote(x); });
+                });
+
+                vector<I> fixed{ b };
+                size_t parity = 0;
+                for (size_t k = 1; k < starts.size(); k++)
+                {
+                    parity ^= quotes[k - 1] & 1;
+
+                    I s = parity == 0 ? starts[k] : find_delim(starts[k], e, true);
+                    if (s < e && s > fixed.back())
+                    {
+                        fixed.push_back(s);
+                    }
+                }
+
+                return fixed;
+            }
+
+            template< typename T >
+            bool is_quote(const T& x) const
+            {
+                if constexpr (misc::is_byte_v<T>)
+                {
+                    return static_cast<unsigned char>(x) == quote;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            // Position after the first delimiter outside of quotes at or after from, or e
+            template< typename I >
+            I find_delim(I from, I e, bool in_quotes)
+            {
+                auto set = parsers::first_set(delim);
+
+                for (I p = from; p < e; ++p)
+                {
+                    if (in_quotes || is_quote(*p))
+                    {
+                        in_quotes ^= is_quote(*p);
+                        continue;
+                    }
+
+                    if constexpr (misc::is_byte_v<typename iterator_traits<I>::value_type>)
+                    {
+                        if (set.has_value() && !(*set)[static_cast<unsigned char>(*p)])
+                        {
+                            continue;
+                        }
+                    }
+
+                    auto delim_res = parsers::recognize(delim, p, e);
+                    if (delim_res.is_ok())
+                    {
+                        return delim_res.unwrap_ok().pos;
+                    }
+                }
+
+                return e;
+            }
+        };
+    }
+
+    // many(record).with_delim(delim) on several threads, see ParallelMany
+    template< typename P, typename D >
+    auto parallel_many(P record, D delim, size_t threads = 0)
+    {
+        return parallel_many_ns::ParallelMany<P, D>(move(record), move(delim), threads);
+    }
+}
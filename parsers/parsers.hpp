@@ -5,7 +5,19 @@
 #include "sequence.hpp"
 #include "many.hpp"
 #include "alt.hpp"
+#include "keywords.hpp"
+#include "char_class.hpp"
 #include "lit.hpp"
 #include "any.hpp"
 #include "map.hpp"
+#include "memo.hpp"
+#include "arena.hpp"
+#include "fast_fail.hpp"
+#include "compile_time.hpp"
+#include "push.hpp"
+#include "parallel_many.hpp"
 #include "nop.hpp"
+#include "raw.hpp"
+#include "named.hpp"
+#include "rule.hpp"
+#include "number.hpp"
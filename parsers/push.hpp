@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "../res.hpp"
+
+namespace apc::parsers
+{
+    namespace push_ns
+    {
+        using namespace res;
+
+        // Drives a record parser over input that arrives in chunks.
+        // Complete records are passed to the callback as soon as they are parsed,
+        // only the unfinished record is kept and parsed again once enough input
+        // arrives or a chunk may end it, see record_end.
+        // Values that point into the input are only valid during the callback
+        template< typename P, typename F, typename T >
+        struct Push
+        {
+            P parser;
+            F on_record;
+
+            using Ok = size_t;
+            using Err = typename P::Err;
+
+            // Positions are offsets from the start of the stream
+            using R = Result<Ok, Err, size_t>;
+
+        private:
+
+            vector<T> buffer;
+
+            // start of the unfinished record in the buffer
+            size_t start;
+
+            // stream offset of the start of the buffer
+            size_t offset;
+
+            // an unfinished record is tried again only after the input past its
+            // start grew to this size, which keeps long records from being parsed
+            // again on every chunk
+            size_t retry_size;
+
+            // a chunk with it is always tried, see record_end
+            optional<T> end_element;
+
+            size_t n_records;
+
+            // a record that consumed nothing ended the stream there
+            bool stopped;
+
+            optional<res::Err<Err, size_t>> error;
+
+        public:
+
+            Push(P parser, F on_record)
+                : parser(move(parser))
+                , on_record(move(on_record))
+                , buffer()
+                , start(0)
+                , offset(0)
+                , retry_size(1)
+                , end_element()
+                , n_records(0)
+                , stopped(false)
+                , error() {}
+
+            // Chunks that contain value may complete the unfinished record, so
+            // they are parsed right away. Other chunks wait until the unfinished
+            // part doubled. For a stream of lines, record_end('\n') delivers a
+            // line with the feed that ends it
+            auto record_end(T value)&&
+            {
+                end_element = value;
+                return move(*this);
+            }
+
+            // Returns the number of records parsed so far and the stream offset after the last of them.
+            // A record cut off by the end of the chunk waits for the next one
+            R feed(const T* data, size_t n)
+            {
+                if (error.has_value())
+                {
+                    return *error;
+                }
+
+                if (stopped)
+                {
+                    return ok(n_records, offset + start);
+                }
+
+                // drop the parsed records once they make up most of the buffer
+                if (start > buffer.size() / 2)
+                {
+                    buffer.erase(buffer.begin(), buffer.begin() + start);
+                    offset += start;
+                    start = 0;
+                }
+
+                buffer.insert(buffer.end(), data, data + n);
+
+                bool may_end = end_element.has_value() && find(data, data + n, *end_element) != data + n;
+                if (n == 0 || (buffer.size() - start < retry_size && !may_end))
+                {
+                    return ok(n_records, offset + start);
+                }
+
+                PartialInputScope scope(true);
+                return parse_records(false);
+            }
+
+            R feed(basic_string_view<T> chunk)
+            {
+                return feed(chunk.data(), chunk.size());
+            }
+
+            // Parses what is left knowing that no more input follows.
+            // Returns end of input if the input stops in the middle of a record
+            R finish()
+            {
+                if (error.has_value())
+                {
+                    return *error;
+                }
+
+                if (stopped)
+                {
+                    return ok(n_records, offset + start);
+                }
+
+                PartialInputScope scope(false);
+                return parse_records(true);
+            }
+
+        private:
+
+            R parse_records(bool last)
+            {
+                const T* b = buffer.data();
+                const T* e = buffer.data() + buffer.size();
+
+                while (start != buffer.size())
+                {
+                    // the buffer moves and is refilled between feeds, so memos
+                    // must not keep results from one record to the next
+                    auto res = [&]
+                    {
+                        ParseScope parse;
+                        return parser.parse(b + start, e);
+                    }();
+
+                    if (res.is_ok())
+                    {
+                        auto& res_ok = res.unwrap_ok();
+                        size_t end = res_ok.pos - b;
+
+                        on_record(move(res_ok.res));
+                        n_records++;
+
+                        // a record that consumes nothing would be parsed forever,
+                        // and again by every later feed
+                        if (end == start)
+                        {
+                            stopped = true;
+                            return ok(n_records, offset + start);
+                        }
+
+                        start = end;
+                    }
+                    else if (res.is_err())
+                    {
+                        auto& res_err = res.unwrap_err();
+                        error.emplace(move(res_err.err), offset + (res_err.pos - b));
+
+                        return *error;
+                    }
+                    else if (last)
+                    {
+                        return move(res.unwrap_eoi());
+                    }
+                    else
+                    {
+                        retry_size = 2 * (buffer.size() - start);
+
+                        return ok(n_records, offset + start);
+                    }
+                }
+
+                retry_size = 1;
+
+                return ok(n_records, offset + start);
+            }
+        };
+    }
+
+    // Parses a stream of records given in chunks with feed() and ended with finish().
+    // The callback receives the Ok value of every record. A record that consumes
+    // nothing is delivered once and stops the stream
+    template< typename T = char, typename P, typename F >
+    auto push(P parser, F on_record)
+    {
+        return push_ns::Push<P, F, T>(move(parser), move(on_record));
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <iterator>
+#include <string_view>
+
+#include "first_set.hpp"
+#include "recognize.hpp"
+
+namespace apc::parsers
+{
+    namespace raw_ns
+    {
+        using namespace res;
+
+        // Pair of iterators delimiting a part of the input
+        template< typename I >
+        struct Subrange
+        {
+            I b;
+            I e;
+
+            constexpr Subrange(I b, I e) : b(move(b)), e(move(e)) {}
+
+            constexpr I begin() const
+            {
+                return b;
+            }
+
+            constexpr I end() const
+            {
+                return e;
+            }
+
+            constexpr size_t size() const
+            {
+                return distance(b, e);
+            }
+
+            constexpr bool empty() const
+            {
+                return b == e;
+            }
+        };
+
+        template< typename R >
+        struct IsStringView : false_type {};
+
+        template< typename T, typename Tr >
+        struct IsStringView<basic_string_view<T, Tr>> : true_type {};
+
+        template< typename P, typename R >
+        struct Raw
+        {
+            P parser;
+
+            using Ok = R;
+            using Err = typename P::Err;
+
+            constexpr Raw(P parser) : parser(move(parser)) {}
+
+            first_set_ns::FirstSet first_set() const
+            {
+                return parsers::first_set(parser);
+            }
+
+            template< typename I >
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("raw", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return parsers::recognize(parser, b, e)
+                        .fmap_ok([&b](auto& res_ok) -> Result<Ok, Err, I>
+                        {
+                            return ok(make_range(b, res_ok.pos), res_ok.pos);
+                        });
+                });
+            }
+
+            template< typename I >
+            constexpr Result<NilOk, Err, I> recognize(I b, I e)
+            {
+                return instrument::probe("raw", b, [&]() -> Result<NilOk, Err, I>
+                {
+                    return parsers::recognize(parser, b, e);
+                });
+            }
+
+            template< typename I >
+            static constexpr R make_range(I b, I pos)
+            {
+                if constexpr (IsStringView<R>::value)
+                {
+                    static_assert(misc::is_contiguous_iterator_v<I>,
+                                  "raw requires contiguous input, use raw_range for other iterators");
+
+                    if (b == pos)
+                    {
+                        return R();
+                    }
+
+                    return R(misc::to_pointer(b), distance(b, pos));
+                }
+                else
+                {
+                    return R(b, pos);
+                }
+            }
+        };
+    }
+
+    // Returns the part of the input matched by the parser as a string_view.
+    // The parser's own Ok value is not built when the parser supports recognize
+    template< typename T = char, typename P >
+    constexpr auto raw(P parser)
+    {
+        return raw_ns::Raw<P, basic_string_view<T>>(move(parser));
+    }
+
+    // Same as raw but for any iterator type I. Returns a pair of iterators
+    template< typename I, typename P >
+    constexpr auto raw_range(P parser)
+    {
+        return raw_ns::Raw<P, raw_ns::Subrange<I>>(move(parser));
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <utility>
+
+#include "../misc.hpp"
+#include "../res.hpp"
+
+namespace apc::parsers
+{
+    namespace recognize_ns
+    {
+        using namespace res;
+
+        template< typename P, typename I >
+        using recognize_t = decltype(declval<P&>().recognize(declval<I>(), declval<I>()));
+    }
+
+    // Runs the parser only to find out where its match ends.
+    // Parsers that can do this without building their Ok value provide a member `recognize`
+    template< typename P, typename I >
+    constexpr res::Result<res::NilOk, typename P::Err, I> recognize(P& parser, I b, I e)
+    {
+        using namespace recognize_ns;
+
+        if constexpr (misc::is_detected_v<recognize_t, P, I>)
+        {
+            return parser.recognize(b, e);
+        }
+        else
+        {
+            return parser.parse(b, e)
+                .fmap_ok([](auto& res_ok) -> Result<NilOk, typename P::Err, I>
+                {
+                    return ok(NilOk{}, move(res_ok.pos));
+                });
+        }
+    }
+}
@@ -0,0 +1,334 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "first_set.hpp"
+#include "recognize.hpp"
+
+namespace apc::parsers
+{
+    namespace rule_ns
+    {
+        using namespace res;
+
+        // Rules running on this thread, nested in each other
+        inline thread_local size_t depth = 0;
+
+        // About 1.4KB of stack per level for a small grammar built with -O2
+        inline constexpr size_t default_max_depth = 512;
+
+        // Set by the rule that found the nesting too deep. Alternatives swallow
+        // the errors of their children, so the outermost rule reports it
+        template< typename I >
+        struct Exceeded
+        {
+            I pos;
+            size_t max_depth;
+        };
+
+        template< typename I >
+        inline thread_local optional<Exceeded<I>> exceeded;
+
+        struct DepthErr
+        {
+            NilErr prev;
+
+            size_t max_depth;
+
+            DepthErr(size_t max_depth)
+                : prev()
+                , max_depth(max_depth) {}
+
+            tuple<string, size_t> description()
+            {
+                return { "Rules nested deeper than " + to_string(max_depth), 0 };
+            }
+        };
+
+        // An error of any type kept on the heap. The error of a rule can't hold
+        // the error of its definition by value when the definition uses the rule.
+        // Nothing is kept in fast fail mode
+        class AnyErr
+        {
+        public:
+
+            template< typename E, typename = enable_if_t<!is_same_v<decay_t<E>, AnyErr>> >
+            AnyErr(E err)
+                : inner(fast_fail() ? nullptr : make_shared<Holder<E>>(move(err))) {}
+
+            void print_trace(ostream& out, size_t offset, bool first, const TracePositions& positions)
+            {
+                if (inner != nullptr)
+                {
+                    inner->print_trace(out, offset, first, positions);
+                }
+            }
+
+        private:
+
+            struct Base
+            {
+                virtual ~Base() = default;
+
+                virtual void print_trace(ostream& out, size_t offset, bool first, const TracePositions& positions) = 0;
+            };
+
+            template< typename E >
+            struct Holder : Base
+            {
+                E err;
+
+                Holder(E err) : err(move(err)) {}
+
+                void print_trace(ostream& out, size_t offset, bool first, const TracePositions& positions) override
+                {
+                    res::print_trace(err, out, offset, first, positions);
+                }
+            };
+
+            shared_ptr<Base> inner;
+        };
+
+        // The definition of a rule behind plain function pointers, so calling
+        // it costs one indirect call and its type doesn't show in the rule's
+        template< typename Ok, typename Err, typename I >
+        struct State
+        {
+            using ParseFn = Result<Ok, Err, I>(*)(void*, I, I);
+            using RecognizeFn = Result<NilOk, Err, I>(*)(void*, I, I);
+
+            ParseFn parse_fn = &undefined<Ok>;
+            RecognizeFn recognize_fn = &undefined<NilOk>;
+
+            void* parser = nullptr;
+            void (*destroy)(void*) = nullptr;
+
+            first_set_ns::FirstSet first_set;
+            size_t max_depth = default_max_depth;
+
+            State() = default;
+
+            State(const State&) = delete;
+            State& operator=(const State&) = delete;
+
+            ~State()
+            {
+                if (destroy != nullptr)
+                {
+                    destroy(parser);
+                }
+            }
+
+            template< typename P >
+            void define(P new_parser)
+            {
+                static_assert(is_constructible_v<Ok, typename P::Ok>, "the Ok of the definition must convert to the Ok of the rule");
+                static_assert(is_constructible_v<Err, typename P::Err>, "the Err of the rule must be constructible from the Err of the definition");
+
+                P* p = new P(move(new_parser));
+                if (destroy != nullptr)
+                {
+                    destroy(parser);
+                }
+
+                parser = p;
+                destroy = [](void* p) { delete static_cast<P*>(p); };
+
+                parse_fn = [](void* p, I b, I e)
+                {
+                    return convert<Ok>(static_cast<P*>(p)->parse(b, e));
+                };
+
+                recognize_fn = [](void* p, I b, I e)
+                {
+                    return convert<NilOk>(parsers::recognize(*static_cast<P*>(p), b, e));
+                };
+
+                first_set = parsers::first_set(*p);
+            }
+
+            Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("rule", b, [&]
+                {
+                    return enter(b, [&] { return parse_fn(parser, b, e); });
+                });
+            }
+
+            Result<NilOk, Err, I> recognize(I b, I e)
+            {
+                return instrument::probe("rule", b, [&]
+                {
+                    return enter(b, [&] { return recognize_fn(parser, b, e); });
+                });
+            }
+
+        private:
+
+            template< typename F >
+            auto enter(I b, F&& f) -> decltype(f())
+            {
+                if (depth >= max_depth)
+                {
+                    exceeded<I> = Exceeded<I>{ b, max_depth };
+                    return err(Err(DepthErr(max_depth)), move(b));
+                }
+
+                bool outermost = depth == 0;
+                if (outermost)
+                {
+                    exceeded<I>.reset();
+                }
+
+                struct Leave
+                {
+                    ~Leave()
+                    {
+                        depth--;
+                    }
+                };
+
+                depth++;
+                Leave leave;
+
+                auto res = f();
+
+                if (outermost && exceeded<I>.has_value())
+                {
+                    Exceeded<I> at = *exchange(exceeded<I>, nullopt);
+                    if (!res.is_ok())
+                    {
+                        return err(Err(DepthErr(at.max_depth)), move(at.pos));
+                    }
+                }
+
+                return res;
+            }
+
+            template< typename T, typename U, typename E >
+            static Result<T, Err, I> convert(Result<U, E, I>&& res)
+            {
+                if (res.is_ok())
+                {
+                    if constexpr (is_same_v<T, U>)
+                    {
+                        return move(res.unwrap_ok());
+                    }
+                    else
+                    {
+                        return ok(T(move(res.unwrap_ok().res)), move(res.unwrap_ok().pos));
+                    }
+                }
+                else if (res.is_err())
+                {
+                    return err(Err(move(res.unwrap_err().err)), move(res.unwrap_err().pos));
+                }
+                else
+                {
+                    return move(res.unwrap_eoi());
+                }
+            }
+
+            template< typename T >
+            static Result<T, Err, I> undefined(void*, I, I)
+            {
+                throw logic_error("rule used before it was defined");
+            }
+        };
+
+        // Refers to a rule without owning it, the rule must outlive it
+        template< typename Ok_T, typename Err_T, typename I >
+        struct RuleRef
+        {
+            State<Ok_T, Err_T, I>* state;
+
+            using Ok = Ok_T;
+            using Err = Err_T;
+
+            RuleRef(State<Ok_T, Err_T, I>* state) : state(state) {}
+
+            // Known once the rule is defined
+            first_set_ns::FirstSet first_set() const
+            {
+                return state->first_set;
+            }
+
+            Result<Ok, Err, I> parse(I b, I e)
+            {
+                return state->parse(move(b), move(e));
+            }
+
+            Result<NilOk, Err, I> recognize(I b, I e)
+            {
+                return state->recognize(move(b), move(e));
+            }
+        };
+
+        // A parser that can be declared before it is defined, which makes grammars
+        // that refer to themselves possible. The rule owns its definition and
+        // the grammar refers to the rule through ref(), so nothing is copied.
+        // Its input iterator is fixed. The Err must be constructible from the
+        // Err of the definition and from DepthErr, which it fails with when
+        // rules are nested deeper than max_depth on the thread
+        template< typename Ok_T, typename Err_T, typename I >
+        class Rule
+        {
+        public:
+
+            using Ok = Ok_T;
+            using Err = Err_T;
+
+            Rule() : state(make_unique<State<Ok_T, Err_T, I>>()) {}
+
+            auto max_depth(size_t n)&&
+            {
+                state->max_depth = n;
+                return move(*this);
+            }
+
+            template< typename P >
+            void define(P parser)
+            {
+                state->define(move(parser));
+            }
+
+            RuleRef<Ok_T, Err_T, I> ref() const
+            {
+                return RuleRef<Ok_T, Err_T, I>(state.get());
+            }
+
+            first_set_ns::FirstSet first_set() const
+            {
+                return state->first_set;
+            }
+
+            Result<Ok, Err, I> parse(I b, I e)
+            {
+                return state->parse(move(b), move(e));
+            }
+
+            Result<NilOk, Err, I> recognize(I b, I e)
+            {
+                return state->recognize(move(b), move(e));
+            }
+
+        private:
+
+            // on the heap so references stay valid when the rule is moved
+            unique_ptr<State<Ok_T, Err_T, I>> state;
+        };
+    }
+
+    //     rule<Json> value;
+    //     value.define(alt(..., sequence(unit('['), many(value.ref()), unit(']'))));
+    template< typename Ok, typename Err = rule_ns::AnyErr, typename I = const char* >
+    using rule = rule_ns::Rule<Ok, Err, I>;
+}
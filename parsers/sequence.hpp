@@ -1,12 +1,15 @@
 #pragma once
 
+#include <array>
+#include <optional>
 #include <sstream>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 
-#include <iostream>
-
+#include "first_set.hpp"
 #include "nop.hpp"
+#include "recognize.hpp"
 
 namespace apc::parsers
 {
@@ -24,15 +27,17 @@ namespace apc::parsers
         template< typename... Es >
         struct SequenceErr
         {
-            variant<Es...> prev;
+            // empty in fast fail mode
+            optional<variant<Es...>> prev;
 
             SequenceErrCause cause;
 
             size_t n;
             size_t inner_offset;
 
-            SequenceErr(size_t inner_offset, SequenceErrCause cause, variant<Es...> prev, size_t n)
-                : prev(move(prev))
+            template< typename C >
+            constexpr SequenceErr(size_t inner_offset, SequenceErrCause cause, C&& prev, size_t n)
+                : prev(child_err<variant<Es...>>(forward<C>(prev)))
                 , cause(cause)
                 , n(n)
                 , inner_offset(inner_offset) {}
@@ -55,88 +60,36 @@ namespace apc::parsers
             }
         };
 
-        template< typename I, typename E, bool has_delim, typename D, typename P, typename... Ps >
-        auto sequence_impl(size_t n, I b, I e, D& delim, P& head, Ps&... tail) -> Result<tuple<typename P::Ok, typename Ps::Ok...>, E, I>
+        template< bool build, typename P, typename I >
+        constexpr auto parse_element(P& parser, I b, I e)
         {
-            using RetType = Result<tuple<typename P::Ok, typename Ps::Ok...>, E, I>;
+            if constexpr (build)
+            {
+                return parser.parse(b, e);
+            }
+            else
+            {
+                return parsers::recognize(parser, b, e);
+            }
+        }
 
-            I real_b = b;
+        // Positions of the parsers whose values end up in the result
+        template< typename... Ts >
+        constexpr auto kept_indices()
+        {
+            constexpr bool nil[] = { is_same_v<Ts, NilOk>... };
 
-            if constexpr (has_delim)
+            array<size_t, tuple_size_v<without_t_t<NilOk, Ts...>>> ret{};
+            for (size_t n = 0, k = 0; n < sizeof...(Ts); n++)
             {
-                if (n != 0)
+                if (!nil[n])
                 {
-                    auto delim_res = delim.parse(b, e)
-                        .map_err([n](auto& delim_err)
-                        {
-                            return err(
-                                E(0, SequenceErrCause::Delimiter, move(delim_err.err), n+1),
-                                delim_err.pos
-                            );
-                        })
-                        .visit_eoi([n](auto& delim_eoi)
-                        {
-                            delim_eoi.trace.push_back("Sequence delimiter before position "s + std::to_string(n+1));
-                        });
-
-                    if (delim_res.is_ok())
-                    {
-                        real_b = delim_res.unwrap_ok().pos;
-                    }
-                    else
-                    {
-                        if (delim_res.is_err())
-                        {
-                            return delim_res.unwrap_err();
-                        }
-                        else
-                        {
-                            return delim_res.unwrap_eoi();
-                        }
-                    }
+                    ret[k++] = n;
                 }
             }
-
-            return head.parse(real_b, e)
-                .map_err([n](auto& head_err)
-                {
-                    return err(
-                        E(0, SequenceErrCause::Parser, move(head_err.err), n+1),
-                        head_err.pos
-                    );
-                })
-                .visit_eoi([n](auto& head_eoi)
-                {
-                    head_eoi.trace.push_back("Sequence position "s + std::to_string(n+1));
-                })
-                .fmap_ok([&](auto& head_ok) -> RetType
-                {
-                    if constexpr (sizeof...(Ps) == 0)
-                    {
-                        return ok(make_tuple(move(head_ok.res)), head_ok.pos);
-                    }
-                    else
-                    {
-                        return sequence_impl<I, E, has_delim>(n+1, head_ok.pos, e, delim, tail...)
-                            .map_ok([&head_ok](auto& tail_ok)
-                            {
-                                return ok(
-                                    tuple_cat(
-                                        make_tuple(move(head_ok.res)),
-                                        move(tail_ok.res)
-                                    ),
-                                    tail_ok.pos
-                                );
-                            })
-                            .visit_err([&b](auto& tail_err)
-                            {
-                                tail_err.err.inner_offset += distance(b, tail_err.pos);
-                            });
-                    }
-                });
+            return ret;
         }
 
-
         template< bool has_delim, typename D, typename... Ps >
         struct Sequence
         {
@@ -163,12 +116,18 @@ namespace apc::parsers
                                                         >
                                          >;
 
-            Sequence(DelimType delim, tuple<Ps...> parsers)
+            constexpr Sequence(DelimType delim, tuple<Ps...> parsers)
                 : parsers(move(parsers))
                 , delim(move(delim)) {}
 
+            // The delimiter only goes between the parsers so the first parser decides
+            first_set_ns::FirstSet first_set() const
+            {
+                return apc::parsers::first_set(get<0>(parsers));
+            }
+
             template< typename NewD >
-            auto with_delim(NewD new_delim_parser)&&
+            constexpr auto with_delim(NewD new_delim_parser)&&
             {
                 return Sequence<true, NewD, Ps...>(
                     move(new_delim_parser),
@@ -177,41 +136,126 @@ namespace apc::parsers
             }
 
             template< typename I >
-            Result<Ok, Err, I> parse(I b, I e)
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("sequence", b, [&]() -> Result<Ok, Err, I>
+                {
+                    return run<true>(b, e, index_sequence_for<Ps...>());
+                });
+            }
+
+            // Same as parse but without building the tuple of values
+            template< typename I >
+            constexpr Result<NilOk, Err, I> recognize(I b, I e)
+            {
+                return instrument::probe("sequence", b, [&]() -> Result<NilOk, Err, I>
+                {
+                    return run<false>(b, e, index_sequence_for<Ps...>());
+                });
+            }
+
+        private:
+
+            // Every value is parsed into its own slot and moved out once at the end
+            using Slots = tuple<optional<typename Ps::Ok>...>;
+
+            static constexpr auto kept = kept_indices<typename Ps::Ok...>();
+
+            // When build is false the values are not built and the result is NilOk
+            template< bool build, typename I, size_t... Ns >
+            constexpr Result<conditional_t<build, Ok, NilOk>, Err, I> run(I b, I e, index_sequence<Ns...>)
+            {
+                using R = Result<conditional_t<build, Ok, NilOk>, Err, I>;
+
+                I iter = b;
+                optional<R> failure;
+                conditional_t<build, Slots, NilOk> slots;
+
+                // stops at the first parser that doesn't succeed
+                if (!(step<build, Ns>(b, iter, e, slots, failure) && ...))
+                {
+                    return move(*failure);
+                }
+
+                if constexpr (build)
+                {
+                    return ok(take(slots, make_index_sequence<kept.size()>()), iter);
+                }
+                else
+                {
+                    return ok(NilOk{}, iter);
+                }
+            }
+
+            template< bool build, size_t N, typename I, typename S, typename R >
+            constexpr bool step(I b, I& iter, I e, S& slots, optional<R>& failure)
             {
-                auto res = apply([&b, &e, this](auto&... parsers)
+                if constexpr (has_delim && N != 0)
                 {
-                    return sequence_impl<I, Err, has_delim>(0, b, e, delim, parsers...);
-                }, parsers);
+                    auto delim_res = parsers::recognize(delim, iter, e);
+
+                    if (delim_res.is_err())
+                    {
+                        failure.emplace(err(
+                            Err(distance(b, iter), SequenceErrCause::Delimiter, move(delim_res.unwrap_err().err), N+1),
+                            delim_res.unwrap_err().pos
+                        ));
+                        return false;
+                    }
+                    else if (delim_res.is_eoi())
+                    {
+                        delim_res.unwrap_eoi().push("Sequence delimiter before position {}", N+1);
+                        failure.emplace(move(delim_res.unwrap_eoi()));
+                        return false;
+                    }
+
+                    iter = delim_res.unwrap_ok().pos;
+                }
 
-                return res
-                    .map_ok([](auto& res_ok)
+                auto res = parse_element<build>(get<N>(parsers), iter, e);
+
+                if (res.is_ok())
+                {
+                    if constexpr (build)
                     {
-                        if constexpr (is_same_v<Ok, RetTypes>)
-                        {
-                            return ok(
-                                move_ref_tuple(
-                                    without_t<NilOk>(
-                                        ref_tuple(res_ok.res)
-                                    )
-                                ),
-                                res_ok.pos
-                            );
-                        }
-                        else
-                        {
-                            return ok(
-                                move(get<0>(without_t<NilOk>(ref_tuple(res_ok.res)))),
-                                res_ok.pos
-                            );
-                        }
-                    });
+                        get<N>(slots).emplace(move(res.unwrap_ok().res));
+                    }
+                    iter = res.unwrap_ok().pos;
+                    return true;
+                }
+                else if (res.is_err())
+                {
+                    failure.emplace(err(
+                        Err(distance(b, iter), SequenceErrCause::Parser, move(res.unwrap_err().err), N+1),
+                        res.unwrap_err().pos
+                    ));
+                    return false;
+                }
+                else
+                {
+                    res.unwrap_eoi().push("Sequence position {}", N+1);
+                    failure.emplace(move(res.unwrap_eoi()));
+                    return false;
+                }
+            }
+
+            template< size_t... Ks >
+            constexpr Ok take(Slots& slots, index_sequence<Ks...>)
+            {
+                if constexpr (is_same_v<Ok, RetTypes>)
+                {
+                    return Ok(move(*get<kept[Ks]>(slots))...);
+                }
+                else
+                {
+                    return move(*get<kept[0]>(slots));
+                }
             }
         };
     }
 
     template< typename... Ps >
-    auto sequence(Ps... parsers)
+    constexpr auto sequence(Ps... parsers)
     {
         static_assert(sizeof...(Ps) > 0, "sequence parser requires at least one argument");
         return sequence_ns::Sequence<false, nop_ns::Nop, Ps...>(0, make_tuple(move(parsers)...));
@@ -1,10 +1,12 @@
 #pragma once
 
+#include <cstring>
 #include <string>
 #include <sstream>
 
 #include "../misc.hpp"
 #include "../res.hpp"
+#include "first_set.hpp"
 
 namespace apc::parsers
 {
@@ -20,7 +22,7 @@ namespace apc::parsers
             T expected;
             T got;
 
-            UnitErr(T expected, T got)
+            constexpr UnitErr(T expected, T got)
                 : prev()
                 , expected(move(expected))
                 , got(move(got)) {}
@@ -50,38 +52,78 @@ namespace apc::parsers
             using Ok = T;
             using Err = UnitErr<T>;
 
-            Unit(T unit) : unit(unit) {}
+            constexpr Unit(T unit) : unit(move(unit)) {}
 
-            template< typename I >
-            Result<Ok, Err, I> parse(I b, I e)
+            first_set_ns::FirstSet first_set() const
             {
-                if (b >= e)
+                return first_set_ns::of_element(unit);
+            }
+
+            // Like lit, units that are expensive to copy are left out in fast fail mode
+            template< typename G >
+            constexpr UnitErr<T> make_err(G&& got) const
+            {
+                if constexpr (is_default_constructible_v<T> && !is_trivially_copyable_v<T>)
                 {
-                    if constexpr (misc::is_printable_v<T>)
+                    if (fast_fail())
                     {
-                        stringstream sstream;
-                        sstream << "Unit expecting "
-                                << '"' << unit << '"';
-                        return EOI(sstream.str());
-                    }
-                    else
-                    {
-                        return EOI("Unit");
+                        return UnitErr<T>(T(), T());
                     }
                 }
 
-                if (*b == unit)
+                return UnitErr<T>(unit, forward<G>(got));
+            }
+
+            template< typename I >
+            constexpr Result<Ok, Err, I> parse(I b, I e)
+            {
+                return instrument::probe("unit", b, [&]() -> Result<Ok, Err, I>
                 {
-                    return ok(*b, next(b));
-                }
+                    if (b == e)
+                    {
+                        if constexpr (is_same_v<T, char>)
+                        {
+                            return EOI("Unit expecting \"{c}\"", static_cast<unsigned char>(unit));
+                        }
+                        else if constexpr (is_integral_v<T> && is_signed_v<T>)
+                        {
+                            return EOI("Unit expecting {i}", static_cast<size_t>(static_cast<long long>(unit)));
+                        }
+                        else if constexpr (is_integral_v<T>)
+                        {
+                            return EOI("Unit expecting {}", static_cast<size_t>(unit));
+                        }
+                        else if constexpr (is_floating_point_v<T> && sizeof(double) == sizeof(size_t))
+                        {
+                            if (!misc::is_constant_evaluated())
+                            {
+                                size_t bits;
+                                double value = unit;
+                                memcpy(&bits, &value, sizeof(bits));
+                                return EOI("Unit expecting {f}", bits);
+                            }
+
+                            return EOI("Unit");
+                        }
+                        else
+                        {
+                            return EOI("Unit");
+                        }
+                    }
+
+                    if (*b == unit)
+                    {
+                        return ok(*b, next(b));
+                    }
 
-                return err(UnitErr<T>(unit, *b), b);
+                    return err(make_err(*b), b);
+                });
             }
         };
     }
 
     template< typename T >
-    auto unit(T unit)
+    constexpr auto unit(T unit)
     {
         return unit_ns::Unit<T>(move(unit));
     }
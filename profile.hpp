@@ -0,0 +1,424 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "misc.hpp"
+
+// Opt-in timing of the rules of a grammar. With APC_PROFILE defined every
+// named parser records per label its calls, how they ended, the time spent in
+// it with and without the named parsers inside it and how often it was run
+// again at a position it already ran at, which is time lost to backtracking.
+// The stacks of labels are kept too and can be written as folded stacks for
+// flame graph tools. Without it nothing is recorded
+
+namespace apc::profile
+{
+    using namespace std;
+
+#if defined(APC_PROFILE)
+    inline constexpr bool enabled = true;
+#else
+    inline constexpr bool enabled = false;
+#endif
+
+    // Time stamp counter where there is one, nanoseconds otherwise
+    inline uint64_t ticks()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Measured once against the steady clock
+    inline double ticks_per_second()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        static double ret = []
+        {
+            auto start = chrono::steady_clock::now();
+            uint64_t start_ticks = ticks();
+
+            while (chrono::steady_clock::now() - start < chrono::milliseconds(20)) {}
+
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            return (ticks() - start_ticks) / elapsed.count();
+        }();
+        return ret;
+#else
+        return 1e9;
+#endif
+    }
+
+    struct Rule
+    {
+        size_t calls = 0;
+        size_t oks = 0;
+        size_t errs = 0;
+        size_t eois = 0;
+
+        // calls at a position the rule already ran at during the same parse
+        size_t reentries = 0;
+
+        // recursive calls are only counted once in the inclusive time
+        uint64_t inclusive = 0;
+        uint64_t exclusive = 0;
+
+        // calls of the rule that are running
+        size_t active = 0;
+
+        Rule& operator+=(const Rule& other)
+        {
+            calls += other.calls;
+            oks += other.oks;
+            errs += other.errs;
+            eois += other.eois;
+            reentries += other.reentries;
+            inclusive += other.inclusive;
+            exclusive += other.exclusive;
+            return *this;
+        }
+    };
+
+    // One stack of labels, the node at index 0 is the empty stack
+    struct Node
+    {
+        const char* label;
+        size_t parent;
+
+        // spent in the rule itself when called from this stack
+        uint64_t self;
+    };
+
+    template< typename A, typename B >
+    struct PairHash
+    {
+        size_t operator()(const pair<A, B>& p) const
+        {
+            return hash<A>()(p.first) * 31 + hash<B>()(p.second);
+        }
+    };
+
+    // Everything recorded, merged by the text of the labels
+    struct Profile
+    {
+        unordered_map<string, Rule> rules;
+
+        // labels joined by ';' from the outermost
+        unordered_map<string, uint64_t> stacks;
+    };
+
+    struct Thread;
+
+    struct Global
+    {
+        mutex m;
+        vector<Thread*> live;
+        Profile retired;
+    };
+
+    inline Global& global()
+    {
+        static Global g;
+        return g;
+    }
+
+    inline void add(Profile& profile, const Thread& thread);
+
+    struct Thread
+    {
+        unordered_map<const char*, Rule> rules;
+
+        vector<Node> nodes{ Node{ nullptr, 0, 0 } };
+        unordered_map<pair<size_t, const char*>, size_t, PairHash<size_t, const char*>> children;
+        size_t current = 0;
+
+        // time spent in the named parsers inside the innermost running one
+        uint64_t* inner = nullptr;
+
+        // rules and positions they ran at since the outermost named parser started,
+        // forgotten when there are max_visited of them so a long input takes
+        // bounded memory. Re-entries that far back are not counted
+        static constexpr size_t max_visited = 1 << 16;
+        unordered_set<pair<const char*, const void*>, PairHash<const char*, const void*>> visited;
+        size_t depth = 0;
+
+        Thread()
+        {
+            lock_guard lock(global().m);
+            global().live.push_back(this);
+        }
+
+        ~Thread()
+        {
+            lock_guard lock(global().m);
+            auto& live = global().live;
+            live.erase(find(live.begin(), live.end(), this));
+            add(global().retired, *this);
+        }
+
+        size_t child(size_t parent, const char* label)
+        {
+            auto [iter, inserted] = children.try_emplace({ parent, label }, nodes.size());
+            if (inserted)
+            {
+                nodes.push_back(Node{ label, parent, 0 });
+            }
+            return iter->second;
+        }
+
+        void clear()
+        {
+            rules.clear();
+            nodes.resize(1);
+            children.clear();
+            visited.clear();
+        }
+    };
+
+    inline void add(Profile& profile, const Thread& thread)
+    {
+        for (auto& [label, rule] : thread.rules)
+        {
+            profile.rules[label] += rule;
+        }
+
+        for (size_t n = 1; n < thread.nodes.size(); n++)
+        {
+            if (thread.nodes[n].self == 0)
+            {
+                continue;
+            }
+
+            string stack;
+            for (size_t k = n; k != 0; k = thread.nodes[k].parent)
+            {
+                stack.insert(0, stack.empty() ? string(thread.nodes[k].label) : string(thread.nodes[k].label) + ";");
+            }
+            profile.stacks[stack] += thread.nodes[n].self;
+        }
+    }
+
+    inline Thread& thread()
+    {
+        thread_local Thread t;
+        return t;
+    }
+
+    // Positions are told apart by the address of their element, so only
+    // inputs whose elements are references count re-entries
+    template< typename I >
+    const void* address(const I& b, const I& e)
+    {
+        if constexpr (is_lvalue_reference_v<decltype(*b)>)
+        {
+            if (b != e)
+            {
+                return addressof(*b);
+            }
+        }
+
+        return nullptr;
+    }
+
+    // The part of the thread's state a running rule changes, put back when
+    // the rule returns or throws
+    struct Running
+    {
+        Thread& t;
+        Rule& rule;
+        size_t parent;
+        uint64_t* outer;
+
+        Running(Thread& t, Rule& rule, size_t node, uint64_t* inner)
+            : t(t)
+            , rule(rule)
+            , parent(exchange(t.current, node))
+            , outer(exchange(t.inner, inner))
+        {
+            t.depth++;
+            rule.active++;
+        }
+
+        Running(const Running&) = delete;
+        Running& operator=(const Running&) = delete;
+
+        ~Running()
+        {
+            rule.active--;
+            t.depth--;
+
+            t.current = parent;
+            t.inner = outer;
+
+            if (t.depth == 0)
+            {
+                t.visited.clear();
+            }
+        }
+    };
+
+    // Runs f, the body of the parser named label, and records it
+    template< typename I, typename F >
+    constexpr auto run(const char* label, I b, I e, F&& f)
+    {
+        if constexpr (!enabled)
+        {
+            return f();
+        }
+        else
+        {
+            if (misc::is_constant_evaluated())
+            {
+                return f();
+            }
+
+            Thread& t = thread();
+            Rule& rule = t.rules[label];
+
+            if (const void* at = address(b, e); at != nullptr)
+            {
+                if (t.visited.size() >= Thread::max_visited)
+                {
+                    t.visited.clear();
+                }
+
+                if (!t.visited.emplace(label, at).second)
+                {
+                    rule.reentries++;
+                }
+            }
+
+            size_t node = t.child(t.current, label);
+
+            uint64_t inner = 0;
+            uint64_t elapsed = 0;
+
+            auto res = [&]
+            {
+                Running running(t, rule, node, &inner);
+
+                uint64_t start = ticks();
+                auto ret = f();
+                elapsed = ticks() - start;
+
+                return ret;
+            }();
+
+            rule.calls++;
+            rule.exclusive += elapsed - inner;
+            if (rule.active == 0)
+            {
+                rule.inclusive += elapsed;
+            }
+            t.nodes[node].self += elapsed - inner;
+
+            if (t.inner != nullptr)
+            {
+                *t.inner += elapsed;
+            }
+
+            if (res.is_ok())
+            {
+                rule.oks++;
+            }
+            else if (res.is_err())
+            {
+                rule.errs++;
+            }
+            else
+            {
+                rule.eois++;
+            }
+
+            return res;
+        }
+    }
+
+    // Profiles of all threads. Threads that are still parsing while this runs may be counted partly
+    inline Profile collect()
+    {
+        lock_guard lock(global().m);
+
+        Profile ret = global().retired;
+        for (Thread* t : global().live)
+        {
+            add(ret, *t);
+        }
+        return ret;
+    }
+
+    // Forgets everything recorded so far. No thread may be parsing meanwhile
+    inline void reset()
+    {
+        lock_guard lock(global().m);
+        global().retired = Profile();
+        for (Thread* t : global().live)
+        {
+            t->clear();
+        }
+    }
+
+    // Prints a table of the rules, the ones with the most exclusive time first
+    inline void report(ostream& out)
+    {
+        Profile profile = collect();
+
+        vector<pair<string, Rule>> rules(profile.rules.begin(), profile.rules.end());
+        sort(rules.begin(), rules.end(), [](auto& a, auto& b)
+        {
+            return a.second.exclusive > b.second.exclusive;
+        });
+
+        double ms_per_tick = 1e3 / ticks_per_second();
+
+        char line[256];
+        snprintf(line, sizeof(line), "%-24s %10s %12s %12s %7s %7s %7s %10s\n",
+                 "rule", "calls", "incl ms", "excl ms", "ok %", "err %", "eoi %", "reentries");
+        out << line;
+
+        for (auto& [label, r] : rules)
+        {
+            double calls = max<size_t>(r.calls, 1);
+
+            snprintf(line, sizeof(line), "%-24s %10zu %12.3f %12.3f %7.1f %7.1f %7.1f %10zu\n",
+                     label.c_str(), r.calls,
+                     r.inclusive * ms_per_tick, r.exclusive * ms_per_tick,
+                     100 * r.oks / calls, 100 * r.errs / calls, 100 * r.eois / calls,
+                     r.reentries);
+            out << line;
+        }
+    }
+
+    // One line per stack of labels with the ticks spent in its innermost rule,
+    // the input format of flamegraph.pl and similar tools
+    inline void folded(ostream& out)
+    {
+        Profile profile = collect();
+
+        vector<pair<string, uint64_t>> stacks(profile.stacks.begin(), profile.stacks.end());
+        sort(stacks.begin(), stacks.end());
+
+        for (auto& [stack, self] : stacks)
+        {
+            out << stack << ' ' << self << '\n';
+        }
+    }
+}
@@ -1,16 +1,25 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <tuple>
 #include <optional>
 #include <variant>
 #include <functional>
+#include <memory>
+#include <new>
+#include <memory_resource>
 #include <string_view>
 #include <vector>
 #include <ostream>
 #include <iostream>
 #include <type_traits>
 
+#include "instrument.hpp"
+#include "misc.hpp"
+
 namespace apc::res
 {
     using namespace std;
@@ -19,9 +28,174 @@ namespace apc::res
 
     struct NilErr {};
 
+    // State of the parse running on this thread
+    struct Context
+    {
+        // Errors are not filled in, only their positions are right
+        bool fast_fail = false;
+
+        // The input may continue past its end, so parsers that could still match
+        // with more input report end of input instead of deciding
+        bool partial_input = false;
+
+        // Where results with polymorphic allocators get their memory, nullptr is the default resource
+        pmr::memory_resource* resource = nullptr;
+    };
+
+    inline thread_local Context context;
+
+    // Constant evaluation always parses in the default mode
+
+    constexpr bool fast_fail()
+    {
+        return !misc::is_constant_evaluated() && context.fast_fail;
+    }
+
+    constexpr bool partial_input()
+    {
+        return !misc::is_constant_evaluated() && context.partial_input;
+    }
+
+    inline pmr::memory_resource* memory_resource()
+    {
+        return context.resource != nullptr ? context.resource : pmr::get_default_resource();
+    }
+
+    // The error of a child kept in the error of a combinator as T,
+    // left out in fast fail mode
+    template< typename T, typename E >
+    constexpr optional<T> child_err(E&& err)
+    {
+        if constexpr (is_same_v<decay_t<E>, nullopt_t>)
+        {
+            return nullopt;
+        }
+        else
+        {
+            if (fast_fail())
+            {
+                return nullopt;
+            }
+
+            if constexpr (is_same_v<decay_t<E>, optional<T>>)
+            {
+                return forward<E>(err);
+            }
+            else
+            {
+                return T(forward<E>(err));
+            }
+        }
+    }
+
+    // Sets a field of the context for its lifetime and restores the previous value afterwards
+    template< auto field >
+    struct ContextScope
+    {
+        using T = remove_reference_t<decltype(context.*field)>;
+
+        T prev;
+
+        ContextScope(T value) : prev(context.*field)
+        {
+            context.*field = value;
+        }
+
+        ContextScope(const ContextScope&) = delete;
+        ContextScope& operator=(const ContextScope&) = delete;
+
+        ~ContextScope()
+        {
+            context.*field = prev;
+        }
+    };
+
+    // One top-level parse on this thread. Caches that are only valid for one
+    // parse of one input (memo) belong to the innermost scope and are freed when
+    // it ends, while the input and the memory resource of the parse still exist
+    class ParseScope
+    {
+    public:
+
+        ParseScope() : _id(++n_scopes), outer(current)
+        {
+            current = this;
+        }
+
+        ParseScope(const ParseScope&) = delete;
+        ParseScope& operator=(const ParseScope&) = delete;
+
+        ~ParseScope()
+        {
+            current = outer;
+        }
+
+        // nullptr when no parse opened a scope
+        static ParseScope* innermost()
+        {
+            return current;
+        }
+
+        // Unique on the thread
+        uint64_t id() const
+        {
+            return _id;
+        }
+
+        // Keeps r until the scope ends
+        void keep(shared_ptr<void> r)
+        {
+            kept.push_back(move(r));
+        }
+
+    private:
+
+        static inline thread_local uint64_t n_scopes = 0;
+        static inline thread_local ParseScope* current = nullptr;
+
+        uint64_t _id;
+        ParseScope* outer;
+        vector<shared_ptr<void>> kept;
+    };
+
+    using FastFailScope = ContextScope<&Context::fast_fail>;
+    using PartialInputScope = ContextScope<&Context::partial_input>;
+    using ResourceScope = ContextScope<&Context::resource>;
+
+    template< typename E >
+    using materialize_t = decltype(declval<E&>().materialize());
+
+    // How print_trace shows positions, the offsets from where the parse
+    // started counted from 1 unless print is set. input::LineIndex sets it
+    // to show lines and columns
+    struct TracePositions
+    {
+        // added to the offsets before printing
+        size_t base = 0;
+
+        void (*print)(ostream& out, size_t offset, const void* arg) = nullptr;
+        const void* arg = nullptr;
+
+        void operator()(ostream& out, size_t offset) const
+        {
+            if (print != nullptr)
+            {
+                print(out, base + offset, arg);
+            }
+            else
+            {
+                out << base + offset + 1;
+            }
+        }
+    };
+
+    template< typename E >
+    using print_trace_t = decltype(declval<E&>().print_trace(declval<ostream&>(), size_t(), bool(), declval<const TracePositions&>()));
+
     //TODO: make it work with consts
     template< typename E >
-    void print_trace(E& err, ostream& out = cerr, size_t offset = 0, bool first = true)
+    void print_trace(E& err, ostream& out = cerr, size_t offset = 0, bool first = true,
+                     const TracePositions& positions = TracePositions())
     {
         if constexpr (is_same_v<E, NilErr>)
         {
@@ -29,20 +203,31 @@ namespace apc::res
         }
         else
         {
-            if constexpr (misc::is_optional(err))
+            if constexpr (misc::is_optional_v<E>)
             {
                 if (err.has_value())
                 {
-                    print_trace(*err, out, offset, first);
+                    print_trace(*err, out, offset, first, positions);
                 }
             }
-            else if constexpr (misc::is_variant(err))
+            else if constexpr (misc::is_variant_v<E>)
             {
-                visit([&out, offset, first](auto& e)
+                visit([&out, offset, first, &positions](auto& e)
                         {
-                            print_trace(e, out, offset, first);
+                            print_trace(e, out, offset, first, positions);
                         }, err);
             }
+            else if constexpr (misc::is_detected_v<materialize_t, E>)
+            {
+                // errors from fast fail mode rebuild the detailed error first
+                auto detailed = err.materialize();
+                print_trace(detailed, out, offset, first, positions);
+            }
+            else if constexpr (misc::is_detected_v<print_trace_t, E>)
+            {
+                // errors whose type is erased print themselves
+                err.print_trace(out, offset, first, positions);
+            }
             else
             {
                 auto [ desc, e_offset ] = err.description();
@@ -52,31 +237,132 @@ namespace apc::res
                     out << "Error trace" << endl;
                 }
 
-                out << "\t" << "At " << offset+1 << ' ' << desc << endl;
+                out << "\t" << "At ";
+                positions(out, offset);
+                out << ' ' << desc << endl;
 
-                print_trace(err.prev, out, offset + e_offset, false);
+                print_trace(err.prev, out, offset + e_offset, false, positions);
             }
         }
     }
 
 
+    // One step of an end of input trace. `text` is a string literal where "{}" is
+    // replaced by `arg` as a number, "{i}" as a signed number, "{f}" as the bits
+    // of a double, "{c}" as a character and "{s}" as the address of a string
+    // that outlives the trace when it is printed
+    struct Frame
+    {
+        const char* text;
+        size_t arg;
+
+        void print(ostream& out) const
+        {
+            string_view rest = text;
+
+            for (size_t pos = rest.find('{'); pos != string_view::npos; pos = rest.find('{'))
+            {
+                out << rest.substr(0, pos);
+                rest.remove_prefix(pos);
+
+                if (rest.substr(0, 2) == "{}")
+                {
+                    out << arg;
+                    rest.remove_prefix(2);
+                }
+                else if (rest.substr(0, 3) == "{c}")
+                {
+                    out << static_cast<char>(arg);
+                    rest.remove_prefix(3);
+                }
+                else if (rest.substr(0, 3) == "{i}")
+                {
+                    out << static_cast<long long>(arg);
+                    rest.remove_prefix(3);
+                }
+                else if (rest.substr(0, 3) == "{s}")
+                {
+                    out << reinterpret_cast<const char*>(arg);
+                    rest.remove_prefix(3);
+                }
+                else if (rest.substr(0, 3) == "{f}")
+                {
+                    double value;
+                    memcpy(&value, &arg, sizeof(value));
+                    out << value;
+                    rest.remove_prefix(3);
+                }
+                else
+                {
+                    out << '{';
+                    rest.remove_prefix(1);
+                }
+            }
+
+            out << rest;
+        }
+    };
+
+    // Frames are kept inline so creating and moving an EOI never allocates.
+    // Frames past the capacity are only counted
     struct EOI
     {
-        vector<string> trace;
+        static constexpr size_t capacity = 8;
+
+        array<Frame, capacity> frames;
+        size_t n_frames;
+        size_t n_dropped;
+
+        constexpr EOI() : frames(), n_frames(0), n_dropped(0) {}
+
+        constexpr EOI(const char* text, size_t arg = 0) : EOI()
+        {
+            push(text, arg);
+        }
+
+        // Frames are pushed from the innermost parser outwards
+        constexpr void push(const char* text, size_t arg = 0)
+        {
+            if (n_frames < capacity)
+            {
+                frames[n_frames++] = Frame{ text, arg };
+            }
+            else
+            {
+                n_dropped++;
+            }
+        }
+
+        constexpr size_t size() const
+        {
+            return n_frames;
+        }
 
-        EOI() : trace() {}
-        EOI(string&& s) : trace{s} {}
-        EOI(string& s) : trace{s} {}
+        constexpr bool empty() const
+        {
+            return n_frames == 0;
+        }
 
+        constexpr const Frame& operator[](size_t n) const
+        {
+            return frames[n];
+        }
     };
 
-    void print_trace(EOI& eoi, ostream& out = cerr)
+    inline void print_trace(EOI& eoi, ostream& out = cerr)
     {
         out << "End of input" << endl;
 
-        for (auto iter = eoi.trace.crbegin(); iter != eoi.trace.crend(); iter++)
+        if (eoi.n_dropped != 0)
         {
-            out << "\tIn " << *iter << endl;
+            out << "\tIn " << eoi.n_dropped << " more parsers" << endl;
+        }
+
+        for (size_t n = eoi.n_frames; n-- > 0;)
+        {
+            out << "\tIn ";
+            eoi.frames[n].print(out);
+            out << endl;
         }
     }
 
@@ -86,7 +372,29 @@ namespace apc::res
         T res;
         I pos;
 
-        Ok(T res, I pos) : res(move(res)), pos(move(pos)) {}
+        constexpr Ok(T res, I pos) : res(move(res)), pos(move(pos)) {}
+
+#if defined(APC_INSTRUMENT)
+        constexpr Ok(const Ok& other) : res(other.res), pos(other.pos)
+        {
+            if (!misc::is_constant_evaluated())
+            {
+                instrument::count_ok_copy();
+            }
+        }
+
+        constexpr Ok(Ok&& other) noexcept(is_nothrow_move_constructible_v<T> && is_nothrow_move_constructible_v<I>)
+            : res(move(other.res)), pos(move(other.pos))
+        {
+            if (!misc::is_constant_evaluated())
+            {
+                instrument::count_ok_move();
+            }
+        }
+
+        Ok& operator=(const Ok&) = default;
+        Ok& operator=(Ok&&) = default;
+#endif
     };
 
     template< typename E, typename I >
@@ -95,117 +403,264 @@ namespace apc::res
         E err;
         I pos;
 
-        Err(E err, I pos) : err(move(err)), pos(move(pos)) {}
+        constexpr Err(E err, I pos) : err(move(err)), pos(move(pos)) {}
+
+#if defined(APC_INSTRUMENT)
+        constexpr Err(const Err& other) : err(other.err), pos(other.pos)
+        {
+            if (!misc::is_constant_evaluated())
+            {
+                instrument::count_err_copy();
+            }
+        }
+
+        constexpr Err(Err&& other) noexcept(is_nothrow_move_constructible_v<E> && is_nothrow_move_constructible_v<I>)
+            : err(move(other.err)), pos(move(other.pos))
+        {
+            if (!misc::is_constant_evaluated())
+            {
+                instrument::count_err_move();
+            }
+        }
+
+        Err& operator=(const Err&) = default;
+        Err& operator=(Err&&) = default;
+#endif
     };
 
     template< typename T, typename I >
-    Ok<T, I> ok(T t, I i)
+    constexpr Ok<T, I> ok(T t, I i)
     {
         return Ok<T, I>(move(t), move(i));
     }
 
     template< typename E, typename I >
-    Err<E, I> err(E e, I i)
+    constexpr Err<E, I> err(E e, I i)
     {
         return Err<E, I>(move(e), move(i));
     }
 
+    // Memory of freed boxes of one type, reused by the next box on the same thread.
+    // Failures are created and dropped all the time while backtracking.
+    // The cache itself is trivially destructible, which keeps the thread_local
+    // cheap to reach, the blocks are freed by a guard set up on the first allocation
+    template< typename X >
+    struct BoxCache
+    {
+        static constexpr size_t capacity = 64;
+
+        array<void*, capacity> blocks;
+        size_t n_blocks;
+
+        void* allocate();
+
+        void deallocate(void* p)
+        {
+            if (n_blocks < capacity)
+            {
+                blocks[n_blocks++] = p;
+            }
+            else
+            {
+                ::operator delete(p);
+            }
+        }
+
+        void release()
+        {
+            for (size_t n = 0; n < n_blocks; n++)
+            {
+                ::operator delete(blocks[n]);
+            }
+            n_blocks = 0;
+        }
+    };
+
+    template< typename X >
+    inline thread_local BoxCache<X> box_cache;
+
+    template< typename X >
+    struct BoxCacheGuard
+    {
+        ~BoxCacheGuard()
+        {
+            box_cache<X>.release();
+        }
+    };
+
+    template< typename X >
+    void* BoxCache<X>::allocate()
+    {
+        if (n_blocks != 0)
+        {
+            return blocks[--n_blocks];
+        }
+
+        thread_local BoxCacheGuard<X> guard;
+        return ::operator new(sizeof(X));
+    }
+
+    // Owns a value on the heap and copies it with itself
+    template< typename X >
+    class Boxed
+    {
+    public:
+
+        Boxed(X x) : ptr(make(move(x))) {}
+
+        Boxed(const Boxed& other) : ptr(make(*other.ptr)) {}
+
+        Boxed(Boxed&& other) noexcept : ptr(exchange(other.ptr, nullptr)) {}
+
+        Boxed& operator=(Boxed other) noexcept
+        {
+            swap(ptr, other.ptr);
+            return *this;
+        }
+
+        ~Boxed()
+        {
+            if (ptr != nullptr)
+            {
+                ptr->~X();
+                box_cache<X>.deallocate(ptr);
+            }
+        }
+
+        X& get()
+        {
+            return *ptr;
+        }
+
+    private:
+
+        X* ptr;
+
+        template< typename U >
+        static X* make(U&& x)
+        {
+            void* p = box_cache<X>.allocate();
+            try
+            {
+                return new (p) X(forward<U>(x));
+            }
+            catch (...)
+            {
+                box_cache<X>.deallocate(p);
+                throw;
+            }
+        }
+    };
+
+    template< typename X >
+    constexpr X& unbox(X& x)
+    {
+        return x;
+    }
+
+    template< typename X >
+    X& unbox(Boxed<X>& x)
+    {
+        return x.get();
+    }
+
+    // With APC_COMPACT_RESULT the error and the end of input of a result are
+    // kept on the heap, so a successful result is not much larger than its Ok.
+    // Errors nest the errors of their children and grow with the grammar,
+    // a failure costs an allocation instead
+#if defined(APC_COMPACT_RESULT)
+    template< typename X >
+    using Failure = Boxed<X>;
+#else
+    template< typename X >
+    using Failure = X;
+#endif
+
     template< typename T, typename E, typename I >
     struct Result
     {
-        variant<Ok<T, I>, Err<E, I>, EOI> inner;
+        variant<Ok<T, I>, Failure<Err<E, I>>, Failure<EOI>> inner;
 
         Result(Result<T, E, I>& res) = default;
         Result(Result<T, E, I>&& res) = default;
         Result(const Result<T, E, I>& res) = default;
 
         template< typename... Ts >
-        Result(Ts&&... ts) : inner(forward<Ts>(ts)...) {}
+        constexpr Result(Ts&&... ts) : inner(forward<Ts>(ts)...) {}
 
-        bool is_ok() const
+        constexpr bool is_ok() const
         {
-            return holds_alternative<Ok<T, I>>(inner);
+            return inner.index() == 0;
         }
 
-        bool is_err() const
+        constexpr bool is_err() const
         {
-            return holds_alternative<Err<E, I>>(inner);
+            return inner.index() == 1;
         }
 
-        bool is_eoi() const
+        constexpr bool is_eoi() const
         {
-            return holds_alternative<EOI>(inner);
+            return inner.index() == 2;
         }
 
-        Ok<T, I>& unwrap_ok()
+        constexpr Ok<T, I>& unwrap_ok()
         {
-            return get<Ok<T, I>>(inner);
+            return get<0>(inner);
         }
 
-        Err<E, I>& unwrap_err()
+        constexpr Err<E, I>& unwrap_err()
         {
-            return get<Err<E, I>>(inner);
+            return unbox(get<1>(inner));
         }
 
-        EOI& unwrap_eoi()
+        constexpr EOI& unwrap_eoi()
         {
-            return get<EOI>(inner);
+            return unbox(get<2>(inner));
         }
 
-        //TODO: use more moves
+        // Every operation has an lvalue version that copies the parts it passes
+        // through and an rvalue version that moves them. Results returned from
+        // parse are temporaries, so chains like parse(b, e).map_ok(...) never copy.
+        // The functions get lvalue references and may move out of them
+
         template< typename F >
-        Result<decltype(invoke_result_t<F, Ok<T, I>&>::res), E, I> map_ok(F pred)
+        constexpr auto map_ok(F pred)&
         {
-            if (is_ok())
-            {
-                return pred(unwrap_ok());
-            }
-            else if (is_err())
-            {
-                return unwrap_err();
-            }
-            else
-            {
-                return unwrap_eoi();
-            }
+            return map_ok_impl(*this, pred);
         }
 
         template< typename F >
-        Result<T, decltype(invoke_result_t<F, Err<E, I>&>::err), I> map_err(F pred)
+        constexpr auto map_ok(F pred)&&
         {
-            if (is_err())
-            {
-                return pred(unwrap_err());
-            }
-            else if (is_ok())
-            {
-                return unwrap_ok();
-            }
-            else
-            {
-                return unwrap_eoi();
-            }
+            return map_ok_impl(move(*this), pred);
         }
 
         template< typename F >
-        Result<T, E, I> map_eoi(F pred)
+        constexpr auto map_err(F pred)&
         {
-            if (is_eoi())
-            {
-                return pred(unwrap_eoi());
-            }
-            else if (is_ok())
-            {
-                return unwrap_ok();
-            }
-            else
-            {
-                return unwrap_err();
-            }
+            return map_err_impl(*this, pred);
+        }
+
+        template< typename F >
+        constexpr auto map_err(F pred)&&
+        {
+            return map_err_impl(move(*this), pred);
+        }
+
+        template< typename F >
+        constexpr Result<T, E, I> map_eoi(F pred)&
+        {
+            return map_eoi_impl(*this, pred);
         }
 
         template< typename F >
-        Result<T, E, I>& visit_ok(F pred)
+        constexpr Result<T, E, I> map_eoi(F pred)&&
+        {
+            return map_eoi_impl(move(*this), pred);
+        }
+
+        template< typename F >
+        constexpr Result<T, E, I>& visit_ok(F pred)&
         {
             if (is_ok())
             {
@@ -216,7 +671,13 @@ namespace apc::res
         }
 
         template< typename F >
-        Result<T, E, I>& visit_err(F pred)
+        constexpr Result<T, E, I> visit_ok(F pred)&&
+        {
+            return move(visit_ok(move(pred)));
+        }
+
+        template< typename F >
+        constexpr Result<T, E, I>& visit_err(F pred)&
         {
             if (is_err())
             {
@@ -227,7 +688,13 @@ namespace apc::res
         }
 
         template< typename F >
-        Result<T, E, I>& visit_eoi(F pred)
+        constexpr Result<T, E, I> visit_err(F pred)&&
+        {
+            return move(visit_err(move(pred)));
+        }
+
+        template< typename F >
+        constexpr Result<T, E, I>& visit_eoi(F pred)&
         {
             if (is_eoi())
             {
@@ -238,53 +705,162 @@ namespace apc::res
         }
 
         template< typename F >
-        invoke_result_t<F, Ok<T, I>&> fmap_ok(F pred)
+        constexpr Result<T, E, I> visit_eoi(F pred)&&
         {
-            if (is_ok())
+            return move(visit_eoi(move(pred)));
+        }
+
+        template< typename F >
+        constexpr invoke_result_t<F, Ok<T, I>&> fmap_ok(F pred)&
+        {
+            return fmap_ok_impl(*this, pred);
+        }
+
+        template< typename F >
+        constexpr invoke_result_t<F, Ok<T, I>&> fmap_ok(F pred)&&
+        {
+            return fmap_ok_impl(move(*this), pred);
+        }
+
+        template< typename F >
+        constexpr invoke_result_t<F, Err<E, I>&> fmap_err(F pred)&
+        {
+            return fmap_err_impl(*this, pred);
+        }
+
+        template< typename F >
+        constexpr invoke_result_t<F, Err<E, I>&> fmap_err(F pred)&&
+        {
+            return fmap_err_impl(move(*this), pred);
+        }
+
+        template< typename F >
+        constexpr invoke_result_t<F, EOI&> fmap_eoi(F pred)&
+        {
+            return fmap_eoi_impl(*this, pred);
+        }
+
+        template< typename F >
+        constexpr invoke_result_t<F, EOI&> fmap_eoi(F pred)&&
+        {
+            return fmap_eoi_impl(move(*this), pred);
+        }
+
+    private:
+
+        // x as an rvalue when Self is one
+        template< typename Self, typename X >
+        static constexpr decltype(auto) pass(X& x)
+        {
+            if constexpr (is_lvalue_reference_v<Self>)
             {
-                return pred(unwrap_ok());
+                return static_cast<X&>(x);
             }
-            else if (is_err())
+            else
             {
-                return unwrap_err();
+                return static_cast<X&&>(x);
+            }
+        }
+
+        template< typename Self, typename F >
+        static constexpr Result<decltype(invoke_result_t<F, Ok<T, I>&>::res), E, I> map_ok_impl(Self&& self, F& pred)
+        {
+            if (self.is_ok())
+            {
+                return pred(self.unwrap_ok());
+            }
+            else if (self.is_err())
+            {
+                return pass<Self>(self.unwrap_err());
             }
             else
             {
-                return unwrap_eoi();
+                return pass<Self>(self.unwrap_eoi());
             }
         }
 
-        template< typename F >
-        invoke_result_t<F, Err<E, I>&> fmap_err(F pred)
+        template< typename Self, typename F >
+        static constexpr Result<T, decltype(invoke_result_t<F, Err<E, I>&>::err), I> map_err_impl(Self&& self, F& pred)
         {
-            if (is_err())
+            if (self.is_err())
             {
-                return pred(unwrap_err());
+                return pred(self.unwrap_err());
             }
-            else if (is_ok())
+            else if (self.is_ok())
             {
-                return unwrap_ok();
+                return pass<Self>(self.unwrap_ok());
             }
             else
             {
-                return unwrap_eoi();
+                return pass<Self>(self.unwrap_eoi());
             }
         }
 
-        template< typename F >
-        invoke_result_t<F, EOI&> fmap_eoi(F pred)
+        template< typename Self, typename F >
+        static constexpr Result<T, E, I> map_eoi_impl(Self&& self, F& pred)
         {
-            if (is_eoi())
+            if (self.is_eoi())
+            {
+                return pred(self.unwrap_eoi());
+            }
+            else if (self.is_ok())
+            {
+                return pass<Self>(self.unwrap_ok());
+            }
+            else
+            {
+                return pass<Self>(self.unwrap_err());
+            }
+        }
+
+        template< typename Self, typename F >
+        static constexpr invoke_result_t<F, Ok<T, I>&> fmap_ok_impl(Self&& self, F& pred)
+        {
+            if (self.is_ok())
+            {
+                return pred(self.unwrap_ok());
+            }
+            else if (self.is_err())
+            {
+                return pass<Self>(self.unwrap_err());
+            }
+            else
+            {
+                return pass<Self>(self.unwrap_eoi());
+            }
+        }
+
+        template< typename Self, typename F >
+        static constexpr invoke_result_t<F, Err<E, I>&> fmap_err_impl(Self&& self, F& pred)
+        {
+            if (self.is_err())
+            {
+                return pred(self.unwrap_err());
+            }
+            else if (self.is_ok())
+            {
+                return pass<Self>(self.unwrap_ok());
+            }
+            else
+            {
+                return pass<Self>(self.unwrap_eoi());
+            }
+        }
+
+        template< typename Self, typename F >
+        static constexpr invoke_result_t<F, EOI&> fmap_eoi_impl(Self&& self, F& pred)
+        {
+            if (self.is_eoi())
             {
-                return pred(unwrap_eoi());
+                return pred(self.unwrap_eoi());
             }
-            else if (is_ok())
+            else if (self.is_ok())
             {
-                return unwrap_ok();
+                return pass<Self>(self.unwrap_ok());
             }
             else
             {
-                return unwrap_err();
+                return pass<Self>(self.unwrap_err());
             }
         }
     };
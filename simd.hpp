@@ -0,0 +1,302 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <type_traits>
+
+#include "misc.hpp"
+
+#if defined(__SSE2__) || defined(__SSSE3__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace apc::simd
+{
+    using namespace std;
+
+    inline size_t count_trailing_zeros(uint32_t mask)
+    {
+        return __builtin_ctz(mask);
+    }
+
+    inline size_t count_trailing_zeros(uint64_t mask)
+    {
+        return __builtin_ctzll(mask);
+    }
+
+    // The lowest byte of a loaded word is the first one in memory, which the
+    // word-at-a-time comparisons need to find the first difference
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    inline constexpr bool little_endian = true;
+#else
+    inline constexpr bool little_endian = false;
+#endif
+
+    // A word from unaligned memory
+    template< typename W >
+    W load(const void* p)
+    {
+        W w;
+        memcpy(&w, p, sizeof(W));
+        return w;
+    }
+
+    // Compares n in [sizeof(W), 2 * sizeof(W)] bytes with two overlapping word loads.
+    // Like mismatch_long it is only called on little-endian targets
+    template< typename W, typename T >
+    size_t mismatch_words(const T* a, const T* b, size_t n)
+    {
+        if (W diff = load<W>(a) ^ load<W>(b))
+        {
+            return count_trailing_zeros(diff) / 8;
+        }
+
+        size_t tail = n - sizeof(W);
+        if (W diff = load<W>(a + tail) ^ load<W>(b + tail))
+        {
+            return tail + count_trailing_zeros(diff) / 8;
+        }
+
+        return n;
+    }
+
+    template< typename T >
+    size_t mismatch_long(const T* a, const T* b, size_t n)
+    {
+        size_t i = 0;
+
+#if defined(__AVX2__)
+        for (; i + 32 <= n; i += 32)
+        {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            unsigned int neq = ~static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+
+            if (neq != 0)
+            {
+                return i + count_trailing_zeros(neq);
+            }
+        }
+#endif
+
+#if defined(__SSE2__)
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            unsigned int neq = ~static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) & 0xFFFF;
+
+            if (neq != 0)
+            {
+                return i + count_trailing_zeros(neq);
+            }
+        }
+#endif
+
+        for (; i + 8 <= n; i += 8)
+        {
+            if (uint64_t diff = load<uint64_t>(a + i) ^ load<uint64_t>(b + i))
+            {
+                return i + count_trailing_zeros(diff) / 8;
+            }
+        }
+
+        if (i == n)
+        {
+            return n;
+        }
+
+        // the last word overlaps bytes that are already known to be equal
+        size_t tail = n - 8;
+        if (uint64_t diff = load<uint64_t>(a + tail) ^ load<uint64_t>(b + tail))
+        {
+            return tail + count_trailing_zeros(diff) / 8;
+        }
+
+        return n;
+    }
+
+    // Returns the index of the first element where a and b differ, or n if they are equal
+    template< typename T >
+    size_t mismatch(const T* a, const T* b, size_t n)
+    {
+        // other byte orders compare byte by byte
+        if constexpr (!misc::is_byte_v<T> || !little_endian)
+        {
+            return std::mismatch(a, a + n, b).first - a;
+        }
+        else
+        {
+            // short literals are the common case and are kept inline
+            if (n >= 16)
+            {
+                return mismatch_long(a, b, n);
+            }
+            else if (n >= 8)
+            {
+                return mismatch_words<uint64_t>(a, b, n);
+            }
+            else if (n >= 4)
+            {
+                return mismatch_words<uint32_t>(a, b, n);
+            }
+
+            size_t i = 0;
+            for (; i < n && a[i] == b[i]; i++);
+
+            return i;
+        }
+    }
+
+    // Calls f with the index of every element of p equal to value, in order
+    template< typename T, typename F >
+    void find_each(const T* p, size_t n, T value, F&& f)
+    {
+        static_assert(misc::is_byte_v<T>, "find_each works on bytes");
+
+        size_t i = 0;
+
+#if defined(__AVX2__)
+        const __m256i value32 = _mm256_set1_epi8(static_cast<char>(value));
+
+        for (; i + 32 <= n; i += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            unsigned int eq = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, value32)));
+
+            for (; eq != 0; eq &= eq - 1)
+            {
+                f(i + count_trailing_zeros(eq));
+            }
+        }
+#endif
+
+#if defined(__SSE2__)
+        const __m128i value16 = _mm_set1_epi8(static_cast<char>(value));
+
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            unsigned int eq = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, value16)));
+
+            for (; eq != 0; eq &= eq - 1)
+            {
+                f(i + count_trailing_zeros(eq));
+            }
+        }
+#endif
+
+        for (; i < n; i++)
+        {
+            if (p[i] == value)
+            {
+                f(i);
+            }
+        }
+    }
+
+    // Lookup tables for testing bytes against a set of 256 values with pshufb.
+    // The row of a byte is selected by its low nibble and the bit in the row by its high nibble
+    struct ClassTable
+    {
+        array<uint64_t, 4> bits;
+
+        // rows for the high nibbles 0-7 and 8-15
+        alignas(16) uint8_t low[16];
+        alignas(16) uint8_t high[16];
+
+        constexpr ClassTable(const array<uint64_t, 4>& bits) : bits(bits), low(), high()
+        {
+            for (size_t c = 0; c < 256; c++)
+            {
+                if (contains(static_cast<unsigned char>(c)))
+                {
+                    uint8_t bit = static_cast<uint8_t>(1u << ((c >> 4) & 7));
+                    (c < 128 ? low : high)[c & 15] |= bit;
+                }
+            }
+        }
+
+        constexpr bool contains(unsigned char c) const
+        {
+            return (bits[c >> 6] >> (c & 63)) & 1;
+        }
+    };
+
+#if defined(__SSSE3__)
+    // 0xFF for the bytes of v that are not in the class
+    inline __m128i not_in_class(__m128i v, __m128i low, __m128i high, __m128i bit)
+    {
+        // pshufb returns 0 for indices with the top bit set, which picks the right table
+        __m128i row = _mm_or_si128(_mm_shuffle_epi8(low, v),
+                                   _mm_shuffle_epi8(high, _mm_xor_si128(v, _mm_set1_epi8(char(0x80)))));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+
+        return _mm_cmpeq_epi8(_mm_and_si128(row, _mm_shuffle_epi8(bit, hi)), _mm_setzero_si128());
+    }
+#endif
+
+#if defined(__AVX2__)
+    inline __m256i not_in_class(__m256i v, __m256i low, __m256i high, __m256i bit)
+    {
+        __m256i row = _mm256_or_si256(_mm256_shuffle_epi8(low, v),
+                                      _mm256_shuffle_epi8(high, _mm256_xor_si256(v, _mm256_set1_epi8(char(0x80)))));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+
+        return _mm256_cmpeq_epi8(_mm256_and_si256(row, _mm256_shuffle_epi8(bit, hi)), _mm256_setzero_si256());
+    }
+#endif
+
+    // Returns the length of the longest prefix of p whose bytes are all in the class
+    template< typename T >
+    size_t span(const T* p, size_t n, const ClassTable& table)
+    {
+        static_assert(misc::is_byte_v<T>, "span works on bytes");
+
+        size_t i = 0;
+
+#if defined(__SSSE3__)
+        // bit table[h] selects the bit of the high nibble h in a row
+        const __m128i bit = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, char(128),
+                                          1, 2, 4, 8, 16, 32, 64, char(128));
+        const __m128i low = _mm_load_si128(reinterpret_cast<const __m128i*>(table.low));
+        const __m128i high = _mm_load_si128(reinterpret_cast<const __m128i*>(table.high));
+
+#if defined(__AVX2__)
+        const __m256i bit2 = _mm256_broadcastsi128_si256(bit);
+        const __m256i low2 = _mm256_broadcastsi128_si256(low);
+        const __m256i high2 = _mm256_broadcastsi128_si256(high);
+
+        for (; i + 32 <= n; i += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            unsigned int outside = static_cast<unsigned int>(_mm256_movemask_epi8(not_in_class(v, low2, high2, bit2)));
+
+            if (outside != 0)
+            {
+                return i + count_trailing_zeros(outside);
+            }
+        }
+#endif
+
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            unsigned int outside = static_cast<unsigned int>(_mm_movemask_epi8(not_in_class(v, low, high, bit)));
+
+            if (outside != 0)
+            {
+                return i + count_trailing_zeros(outside);
+            }
+        }
+#endif
+
+        // without pshufb the bitmap is tested one byte at a time
+        for (; i < n && table.contains(static_cast<unsigned char>(p[i])); i++);
+
+        return i;
+    }
+}
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace apc::containers
+{
+    using namespace std;
+
+    // A vector that keeps up to N elements inside itself and only allocates
+    // when it grows past them
+    template< typename T, size_t N >
+    class small_vector
+    {
+        static_assert(N > 0, "small_vector needs room for at least one element");
+
+    public:
+
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        small_vector() : _data(inline_data()), _size(0), _capacity(N) {}
+
+        small_vector(initializer_list<T> elems) : small_vector()
+        {
+            reserve(elems.size());
+            for (const auto& elem : elems)
+            {
+                push_back(elem);
+            }
+        }
+
+        small_vector(const small_vector& other) : small_vector()
+        {
+            reserve(other._size);
+            uninitialized_copy(other.begin(), other.end(), _data);
+            _size = other._size;
+        }
+
+        small_vector(small_vector&& other) noexcept(is_nothrow_move_constructible_v<T>) : small_vector()
+        {
+            take(move(other));
+        }
+
+        small_vector& operator=(const small_vector& other)
+        {
+            if (this != &other)
+            {
+                clear();
+                reserve(other._size);
+                uninitialized_copy(other.begin(), other.end(), _data);
+                _size = other._size;
+            }
+
+            return *this;
+        }
+
+        small_vector& operator=(small_vector&& other) noexcept(is_nothrow_move_constructible_v<T>)
+        {
+            if (this != &other)
+            {
+                clear();
+                release();
+                take(move(other));
+            }
+
+            return *this;
+        }
+
+        ~small_vector()
+        {
+            clear();
+            release();
+        }
+
+        iterator begin() { return _data; }
+        iterator end() { return _data + _size; }
+        const_iterator begin() const { return _data; }
+        const_iterator end() const { return _data + _size; }
+
+        T* data() { return _data; }
+        const T* data() const { return _data; }
+
+        size_t size() const { return _size; }
+        size_t capacity() const { return _capacity; }
+        bool empty() const { return _size == 0; }
+
+        // Whether the elements are still stored inside the vector itself
+        bool is_inline() const { return _data == inline_data(); }
+
+        T& operator[](size_t n) { return _data[n]; }
+        const T& operator[](size_t n) const { return _data[n]; }
+
+        T& front() { return _data[0]; }
+        const T& front() const { return _data[0]; }
+        T& back() { return _data[_size - 1]; }
+        const T& back() const { return _data[_size - 1]; }
+
+        void reserve(size_t n)
+        {
+            if (n > _capacity)
+            {
+                grow(n);
+            }
+        }
+
+        template< typename... Args >
+        T& emplace_back(Args&&... args)
+        {
+            if (_size == _capacity)
+            {
+                // the new element is built first, args may refer to the old elements
+                T* new_data = allocate(2 * _capacity);
+                try
+                {
+                    new (new_data + _size) T(forward<Args>(args)...);
+                }
+                catch (...)
+                {
+                    deallocate(new_data);
+                    throw;
+                }
+
+                try
+                {
+                    replace_buffer(new_data, 2 * _capacity);
+                }
+                catch (...)
+                {
+                    new_data[_size].~T();
+                    deallocate(new_data);
+                    throw;
+                }
+            }
+            else
+            {
+                new (_data + _size) T(forward<Args>(args)...);
+            }
+
+            _size++;
+
+            return back();
+        }
+
+        void push_back(const T& elem)
+        {
+            emplace_back(elem);
+        }
+
+        void push_back(T&& elem)
+        {
+            emplace_back(move(elem));
+        }
+
+        void pop_back()
+        {
+            _size--;
+            _data[_size].~T();
+        }
+
+        void clear()
+        {
+            destroy(_data, _data + _size);
+            _size = 0;
+        }
+
+        friend bool operator==(const small_vector& a, const small_vector& b)
+        {
+            return a._size == b._size && equal(a.begin(), a.end(), b.begin());
+        }
+
+        friend bool operator!=(const small_vector& a, const small_vector& b)
+        {
+            return !(a == b);
+        }
+
+    private:
+
+        T* _data;
+        size_t _size;
+        size_t _capacity;
+
+        alignas(T) unsigned char storage[N * sizeof(T)];
+
+        T* inline_data()
+        {
+            return reinterpret_cast<T*>(storage);
+        }
+
+        const T* inline_data() const
+        {
+            return reinterpret_cast<const T*>(storage);
+        }
+
+        void grow(size_t n)
+        {
+            T* new_data = allocate(n);
+            try
+            {
+                replace_buffer(new_data, n);
+            }
+            catch (...)
+            {
+                deallocate(new_data);
+                throw;
+            }
+        }
+
+        // Moves the elements into a new heap buffer of the given capacity.
+        // If a move throws the vector is unchanged and the buffer is the caller's
+        void replace_buffer(T* new_data, size_t n)
+        {
+            uninitialized_move(_data, _data + _size, new_data);
+            destroy(_data, _data + _size);
+            release();
+
+            _data = new_data;
+            _capacity = n;
+        }
+
+        // Like std::allocator, over-aligned types get the aligned new and delete
+        static constexpr bool over_aligned = alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+        static T* allocate(size_t n)
+        {
+            if constexpr (over_aligned)
+            {
+                return static_cast<T*>(::operator new(n * sizeof(T), align_val_t(alignof(T))));
+            }
+            else
+            {
+                return static_cast<T*>(::operator new(n * sizeof(T)));
+            }
+        }
+
+        static void deallocate(T* p)
+        {
+            if constexpr (over_aligned)
+            {
+                ::operator delete(p, align_val_t(alignof(T)));
+            }
+            else
+            {
+                ::operator delete(p);
+            }
+        }
+
+        // Frees the heap buffer if there is one, the elements must already be destroyed
+        void release()
+        {
+            if (!is_inline())
+            {
+                deallocate(_data);
+                _data = inline_data();
+                _capacity = N;
+            }
+        }
+
+        // Takes the elements of other. This vector must be empty and inline
+        void take(small_vector&& other)
+        {
+            if (other.is_inline())
+            {
+                uninitialized_move(other.begin(), other.end(), _data);
+                _size = other._size;
+                other.clear();
+            }
+            else
+            {
+                _data = exchange(other._data, other.inline_data());
+                _size = exchange(other._size, 0);
+                _capacity = exchange(other._capacity, N);
+            }
+        }
+    };
+}
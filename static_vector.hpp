@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace apc::containers
+{
+    using namespace std;
+
+    // A vector of at most N elements stored inside itself. It never allocates and
+    // all of it is constexpr, so it can hold results of parses at compile time.
+    // The elements live in an array, T must be default constructible
+    template< typename T, size_t N >
+    class static_vector
+    {
+        static_assert(is_default_constructible_v<T>, "static_vector needs default constructible elements");
+
+    public:
+
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        constexpr static_vector() : _data(), _size(0) {}
+
+        constexpr static_vector(initializer_list<T> elems) : static_vector()
+        {
+            for (const auto& elem : elems)
+            {
+                push_back(elem);
+            }
+        }
+
+        constexpr iterator begin() { return _data.data(); }
+        constexpr iterator end() { return _data.data() + _size; }
+        constexpr const_iterator begin() const { return _data.data(); }
+        constexpr const_iterator end() const { return _data.data() + _size; }
+
+        constexpr T* data() { return _data.data(); }
+        constexpr const T* data() const { return _data.data(); }
+
+        constexpr size_t size() const { return _size; }
+        static constexpr size_t capacity() { return N; }
+        constexpr bool empty() const { return _size == 0; }
+
+        constexpr T& operator[](size_t n) { return _data[n]; }
+        constexpr const T& operator[](size_t n) const { return _data[n]; }
+
+        constexpr T& front() { return _data[0]; }
+        constexpr const T& front() const { return _data[0]; }
+        constexpr T& back() { return _data[_size - 1]; }
+        constexpr const T& back() const { return _data[_size - 1]; }
+
+        // Growing past N throws, which stops the compilation in constant evaluation.
+        // many never does, it stops once the vector is full
+        template< typename... Args >
+        constexpr T& emplace_back(Args&&... args)
+        {
+            if (_size == N)
+            {
+                throw length_error("static_vector is full");
+            }
+
+            _data[_size] = T(forward<Args>(args)...);
+            _size++;
+
+            return back();
+        }
+
+        constexpr void push_back(const T& elem)
+        {
+            emplace_back(elem);
+        }
+
+        constexpr void push_back(T&& elem)
+        {
+            emplace_back(move(elem));
+        }
+
+        constexpr void pop_back()
+        {
+            _size--;
+            _data[_size] = T();
+        }
+
+        constexpr void clear()
+        {
+            while (_size != 0)
+            {
+                pop_back();
+            }
+        }
+
+        friend constexpr bool operator==(const static_vector& a, const static_vector& b)
+        {
+            if (a._size != b._size)
+            {
+                return false;
+            }
+
+            for (size_t n = 0; n < a._size; n++)
+            {
+                if (!(a._data[n] == b._data[n]))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        friend constexpr bool operator!=(const static_vector& a, const static_vector& b)
+        {
+            return !(a == b);
+        }
+
+    private:
+
+        array<T, N> _data;
+        size_t _size;
+    };
+}
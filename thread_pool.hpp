@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace apc::concurrency
+{
+    using namespace std;
+
+    // Runs batches of tasks on a fixed set of threads. Every thread starts
+    // with its own share of the tasks and steals from the others when it
+    // runs out, so uneven tasks don't leave threads idle.
+    // The thread calling run takes part in the work
+    class WorkStealingPool
+    {
+    public:
+
+        // n_threads counts the calling thread, 0 uses one thread per core
+        explicit WorkStealingPool(size_t n_threads = 0)
+            : queues(n_threads != 0 ? n_threads : max(1u, thread::hardware_concurrency()))
+            , n_queues(queues.size())
+        {
+            for (size_t n = 1; n < n_queues; n++)
+            {
+                threads.emplace_back([this, n] { worker(n); });
+            }
+        }
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        ~WorkStealingPool()
+        {
+            {
+                lock_guard lock(m);
+                stopping = true;
+            }
+            wake.notify_all();
+
+            for (auto& t : threads)
+            {
+                t.join();
+            }
+        }
+
+        size_t size() const
+        {
+            return n_queues;
+        }
+
+        // Calls f(n) for every n in [0, n_tasks) and returns when all calls are done.
+        // The first exception thrown by f is rethrown here
+        void run(size_t n_tasks, const function<void(size_t)>& f)
+        {
+            lock_guard batch_lock(batch);
+
+            {
+                lock_guard lock(m);
+                job = &f;
+                remaining = n_tasks;
+                error = nullptr;
+            }
+
+            // contiguous shares keep neighbouring tasks on the same thread
+            for (size_t q = 0; q < n_queues; q++)
+            {
+                lock_guard lock(queues[q].m);
+                for (size_t n = n_tasks * q / n_queues; n < n_tasks * (q + 1) / n_queues; n++)
+                {
+                    queues[q].tasks.push_back(n);
+                }
+            }
+
+            {
+                lock_guard lock(m);
+                generation++;
+            }
+            wake.notify_all();
+
+            work(0);
+
+            unique_lock lock(m);
+            done.wait(lock, [&] { return remaining == 0; });
+            job = nullptr;
+
+            if (error)
+            {
+                rethrow_exception(error);
+            }
+        }
+
+    private:
+
+        struct Queue
+        {
+            mutex m;
+            deque<size_t> tasks;
+        };
+
+        vector<Queue> queues;
+        size_t n_queues;
+
+        vector<thread> threads;
+
+        // serializes calls to run
+        mutex batch;
+
+        mutex m;
+        condition_variable wake;
+        condition_variable done;
+
+        const function<void(size_t)>* job = nullptr;
+        size_t remaining = 0;
+        size_t generation = 0;
+        exception_ptr error;
+        bool stopping = false;
+
+        // Takes from the front of the own queue or steals from the back of another
+        bool pop(size_t self, size_t& task)
+        {
+            for (size_t n = 0; n < n_queues; n++)
+            {
+                Queue& q = queues[(self + n) % n_queues];
+                lock_guard lock(q.m);
+
+                if (!q.tasks.empty())
+                {
+                    if (n == 0)
+                    {
+                        task = q.tasks.front();
+                        q.tasks.pop_front();
+                    }
+                    else
+                    {
+                        task = q.tasks.back();
+                        q.tasks.pop_back();
+                    }
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void work(size_t self)
+        {
+            size_t task;
+            while (pop(self, task))
+            {
+                // a popped task keeps its batch, and so the job, alive
+                const function<void(size_t)>* f;
+                {
+                    lock_guard lock(m);
+                    f = job;
+                }
+
+                try
+                {
+                    (*f)(task);
+                }
+                catch (...)
+                {
+                    lock_guard lock(m);
+                    if (!error)
+                    {
+                        error = current_exception();
+                    }
+                }
+
+                lock_guard lock(m);
+                if (--remaining == 0)
+                {
+                    done.notify_all();
+                }
+            }
+        }
+
+        void worker(size_t self)
+        {
+            size_t seen = 0;
+            while (true)
+            {
+                {
+                    unique_lock lock(m);
+                    wake.wait(lock, [&] { return stopping || generation != seen; });
+
+                    if (stopping)
+                    {
+                        return;
+                    }
+                    seen = generation;
+                }
+
+                work(self);
+            }
+        }
+    };
+}